@@ -34,6 +34,7 @@
 #include "gray.hpp"
 #include "rgb.hpp"
 #include "rgba.hpp"
+#include "gray_alpha.hpp"
 #include "cmyk.hpp"
 #include "metafunctions.hpp"
 #include "utilities.hpp"
@@ -295,6 +296,73 @@ struct default_color_converter_impl<rgba_t,rgba_t> {
     }
 };
 
+/// \ingroup ColorConvert
+/// \brief Converting any pixel type to gray + alpha. Note: Supports homogeneous pixels only.
+template <typename C1>
+struct default_color_converter_impl<C1,gray_alpha_t> {
+    template <typename P1, typename P2>
+    void operator()(const P1& src, P2& dst) const {
+        typedef typename channel_type<P2>::type T2;
+        pixel<T2,gray_layout_t> tmp;
+        default_color_converter_impl<C1,gray_t>()(src,tmp);
+        get_color(dst,gray_color_t())=get_color(tmp,gray_color_t());
+        get_color(dst,alpha_t())     =channel_convert<T2>(alpha_or_max(src));
+    }
+};
+
+/// \ingroup ColorConvert
+/// \brief Converting gray + alpha to any pixel type (by multiplying the alpha, as for RGBA). Note: Supports homogeneous pixels only.
+template <typename C2>
+struct default_color_converter_impl<gray_alpha_t,C2> {
+    template <typename P1, typename P2>
+    void operator()(const P1& src, P2& dst) const {
+        typedef typename channel_type<P1>::type T1;
+        default_color_converter_impl<gray_t,C2>()(
+            pixel<T1,gray_layout_t>(channel_multiply(get_color(src,gray_color_t()),get_color(src,alpha_t())))
+            ,dst);
+    }
+};
+
+/// \ingroup ColorConvert
+/// \brief Gray + alpha to RGBA (explicitly provided to avoid ambiguous specializations).
+template <>
+struct default_color_converter_impl<gray_alpha_t,rgba_t> {
+    template <typename P1, typename P2>
+    void operator()(const P1& src, P2& dst) const {
+        typedef typename channel_type<P2>::type T2;
+        pixel<T2,rgb_layout_t> tmp;
+        default_color_converter_impl<gray_t,rgb_t>()(src,tmp);
+        get_color(dst,red_t())  =get_color(tmp,red_t());
+        get_color(dst,green_t())=get_color(tmp,green_t());
+        get_color(dst,blue_t()) =get_color(tmp,blue_t());
+        get_color(dst,alpha_t())=channel_convert<T2>(get_color(src,alpha_t()));
+    }
+};
+
+/// \ingroup ColorConvert
+/// \brief RGBA to gray + alpha (explicitly provided to avoid ambiguous specializations).
+template <>
+struct default_color_converter_impl<rgba_t,gray_alpha_t> {
+    template <typename P1, typename P2>
+    void operator()(const P1& src, P2& dst) const {
+        typedef typename channel_type<P2>::type T2;
+        pixel<T2,gray_layout_t> tmp;
+        default_color_converter_impl<rgb_t,gray_t>()(src,tmp);
+        get_color(dst,gray_color_t())=get_color(tmp,gray_color_t());
+        get_color(dst,alpha_t())     =channel_convert<T2>(get_color(src,alpha_t()));
+    }
+};
+
+/// \ingroup ColorConvert
+/// \brief Gray + alpha to gray + alpha must also be explicitly provided.
+template <>
+struct default_color_converter_impl<gray_alpha_t,gray_alpha_t> {
+    template <typename P1, typename P2>
+    void operator()(const P1& src, P2& dst) const {
+        static_for_each(src,dst,default_channel_converter());
+    }
+};
+
 /// @defgroup ColorConvert Color Space Converion
 /// \ingroup ColorSpaces
 /// \brief Support for conversion between pixels of different color spaces and channel depths
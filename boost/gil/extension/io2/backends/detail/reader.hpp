@@ -26,6 +26,7 @@
 #include "boost/gil/extension/io2/detail/io_error.hpp"
 #include "boost/gil/extension/io2/detail/switch.hpp"
 
+#include "boost/gil/image.hpp"
 #include "boost/gil/planar_pixel_iterator.hpp"
 #include "boost/gil/planar_pixel_reference.hpp"
 #include "boost/gil/typedefs.hpp"
@@ -223,7 +224,13 @@ protected:
     template <typename Image>
     static void do_synchronize_dimensions( Image & image, dimensions_t const & my_dimensions, unsigned int const alignment = 0 )
     {
-        image.recreate( my_dimensions, alignment );
+        // Implementation note:
+        //   The pixels are about to be overwritten by the decoder so default
+        // constructing them would only cost a full (page faulting) memory
+        // pass. The target's (possibly stateful, e.g. huge_page_allocator)
+        // allocator is preserved instead of being reset to a default
+        // constructed one.
+        image.recreate_uninitialized( my_dimensions, alignment, image.allocator() );
     }
 
 
@@ -487,7 +494,7 @@ public: // Images...
     template <typename Image, typename FormatsPolicy>
     Image copy_to_image( FormatsPolicy const formats_policy ) const
     {
-        Image image( impl().dimensions(), backend_traits<Backend>::desired_alignment );
+        Image image( impl().dimensions(), uninitialized_t(), backend_traits<Backend>::desired_alignment );
         impl().copy_to( view( image ), assert_dimensions_match(), formats_policy );
         return image;
     }
@@ -227,6 +227,10 @@ public: /// \ingroup Information
 	}
 
 protected:
+    // Lossless transforms (libjpeg_writer::write_transformed()) drive the
+    // decompressor of a source image.
+    friend class libjpeg_writer;
+
     struct for_decompressor {};
     struct for_compressor   {};
 
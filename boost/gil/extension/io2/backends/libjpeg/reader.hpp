@@ -23,13 +23,16 @@
 #include "boost/gil/extension/io2/detail/io_error.hpp"
 #include "boost/gil/extension/io2/detail/libx_shared.hpp"
 #include "boost/gil/extension/io2/detail/platform_specifics.hpp"
+#include "boost/gil/extension/io2/detail/scratch_arena.hpp"
 #include "boost/gil/extension/io2/detail/shared.hpp"
 
 #include "boost/gil/image_view_factory.hpp"
 
 #include <boost/array.hpp>
 #include <boost/mpl/vector.hpp>
-#include <boost/smart_ptr/scoped_array.hpp>
+
+#include <cstring>
+#include <vector>
 //------------------------------------------------------------------------------
 namespace boost
 {
@@ -130,7 +133,8 @@ public: /// \ingroup Construction
 	template <class Device>
     explicit libjpeg_image( Device & device )
         :
-        libjpeg_base( for_decompressor() )
+        libjpeg_base( for_decompressor() ),
+        bytes_to_skip_( 0 ), input_complete_( true )
     {
     #ifndef BOOST_GIL_THROW_THROUGH_C_SUPPORTED
         if ( setjmp( libjpeg_base::error_handler_target() ) )
@@ -142,6 +146,115 @@ public: /// \ingroup Construction
         read_header();
     }
 
+    /// Tag for constructing a reader fed through push_input() (e.g. from a
+    /// non-blocking socket or a progressive download) instead of a device.
+    struct incremental_input {};
+
+    explicit libjpeg_image( incremental_input )
+        :
+        libjpeg_base( for_decompressor() ),
+        bytes_to_skip_( 0 ), input_complete_( false )
+    {
+        setup_incremental_source();
+    }
+
+public: /// \ingroup Incremental (suspending) input
+    // Implementation note:
+    //   Follows the libjpeg suspending data source protocol (libjpeg.txt,
+    // "I/O suspension"): fill_input_buffer() returns FALSE when it runs out of
+    // pushed data which makes the library back up to the start of the current
+    // marker/MCU row and return a "suspended" status from the high level
+    // call. All the not yet consumed bytes (starting from next_input_byte) are
+    // retained so the call can simply be repeated after more data has been
+    // pushed. Decoding into a view should therefore be done with single-scan
+    // (baseline) images or with enough data buffered to cover a whole scan -
+    // otherwise jpeg_start_decompress() has to consume the complete input
+    // before it stops suspending.
+
+    /// Appends data to the input. Must not be called from within a libjpeg
+    /// callback (i.e. only between the try_*()/resume_*() calls).
+    void push_input( void const * const p_data, std::size_t size )
+    {
+        BOOST_ASSERT( decompressor().src == &source_manager_ );
+        BOOST_ASSERT( !input_complete_ );
+
+        JOCTET const * p_bytes( static_cast<JOCTET const *>( p_data ) );
+        std::size_t const skipped( std::min( bytes_to_skip_, size ) );
+        bytes_to_skip_ -= skipped;
+        p_bytes        += skipped;
+        size           -= skipped;
+
+        // Drop what the library has already consumed and append the new data.
+        std::size_t const consumed( incremental_buffer_.size() - source_manager_.bytes_in_buffer );
+        incremental_buffer_.erase ( incremental_buffer_.begin(), incremental_buffer_.begin() + consumed );
+        incremental_buffer_.insert( incremental_buffer_.end  (), p_bytes, p_bytes + size              );
+
+        source_manager_.next_input_byte = incremental_buffer_.empty() ? NULL : &incremental_buffer_[ 0 ];
+        source_manager_.bytes_in_buffer = incremental_buffer_.size();
+    }
+
+    /// Signals that no more data will be pushed: a truncated stream is then
+    /// completed with a fake EOI marker (as with the blocking sources) instead
+    /// of suspending.
+    void end_input() { input_complete_ = true; }
+
+    /// Returns false if more data is needed to parse the header (in which case
+    /// it should be called again after the next push_input()).
+    bool try_read_header() BOOST_GIL_CAN_THROW
+    {
+        #ifndef BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+            if ( setjmp( libjpeg_base::error_handler_target() ) )
+                libjpeg_base::throw_jpeg_error();
+        #endif // BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+
+        int const result( jpeg_read_header( &decompressor(), true ) );
+        if ( result == JPEG_SUSPENDED )
+            return false;
+        io::detail::io_error_if( result != JPEG_HEADER_OK, "No image in JPEG datastream." );
+        header_read();
+        return true;
+    }
+
+    /// Decodes as many rows of the (whole) target view as the currently pushed
+    /// data allows and returns the total number of rows decoded so far (equal
+    /// to view.height() when done).
+    template <class View>
+    unsigned int resume_read( View const & view ) BOOST_GIL_CAN_THROW
+    {
+        BOOST_ASSERT( decompressor().global_state != DSTATE_START );
+        detail::view_data_t const view_data( view );
+        BOOST_ASSERT( view_data.width_  == static_cast<unsigned int>( dimensions().x ) );
+        BOOST_ASSERT( view_data.height_ == static_cast<unsigned int>( dimensions().y ) );
+
+        #ifndef BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+            if ( setjmp( libjpeg_base::error_handler_target() ) )
+                libjpeg_base::throw_jpeg_error();
+        #endif // BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+
+        if ( decompressor().global_state == DSTATE_READY )
+            decompressor().out_color_space = view_data.format_;
+        BOOST_ASSERT( decompressor().out_color_space == view_data.format_ );
+        if ( decompressor().global_state != DSTATE_SCANNING )
+        {
+            // Also called again while it suspends (DSTATE_PRELOAD/PRESCAN).
+            if ( !jpeg_start_decompress( &decompressor() ) )
+                return 0;
+        }
+
+        while ( decompressor().output_scanline < decompressor().output_height )
+        {
+            JSAMPROW scanlines[ 4 ];
+            unsigned int const rows_left( decompressor().output_height - decompressor().output_scanline );
+            unsigned int const rows     ( std::min<unsigned int>( boost::size( scanlines ), rows_left ) );
+            for ( unsigned int row( 0 ); row < rows; ++row )
+                scanlines[ row ] = view_data.buffer_ + ( decompressor().output_scanline + row ) * view_data.stride_;
+            if ( !read_scanlines( scanlines, rows ) )
+                break;
+        }
+        return decompressor().output_scanline;
+    }
+
+
 
 private: // Private interface for the base backend<> class.
     // Implementation note:
@@ -199,8 +312,8 @@ private: // Private interface for the base backend<> class.
         using namespace detail;
 
         typedef typename MyView::value_type pixel_t;
-        std::size_t           const scanline_length  ( decompressor().image_width * decompressor().num_components );
-        scoped_array<JSAMPLE> const p_scanline_buffer( new JSAMPLE[ scanline_length ] );
+        std::size_t             const scanline_length  ( decompressor().image_width * decompressor().num_components );
+        io::detail::scratch_buffer<JSAMPLE> const p_scanline_buffer( scanline_length                                 );
         JSAMPROW       scanline    ( p_scanline_buffer.get()    );
         JSAMPROW const scanline_end( scanline + scanline_length );
 
@@ -392,7 +505,11 @@ private:
     void read_header()
     {
         BOOST_VERIFY( jpeg_read_header( &decompressor(), true ) == JPEG_HEADER_OK );
+        header_read();
+    }
 
+    void header_read()
+    {
         // Implementation note:
         //   To enable users to setup output scaling we use the output
         // dimensions to report the image dimensions in the dimensions() getter
@@ -447,6 +564,21 @@ private:
     }
 
 
+    void setup_incremental_source()
+    {
+        setup_source();
+
+        source_manager_.next_input_byte = NULL;
+        source_manager_.bytes_in_buffer = 0;
+
+        source_manager_.init_source       = &init_incremental_source ;
+        source_manager_.fill_input_buffer = &fill_incremental_buffer ;
+        source_manager_.skip_input_data   = &skip_incremental_data   ;
+        source_manager_.resync_to_restart = &jpeg_resync_to_restart  ;
+        source_manager_.term_source       = &term_incremental_source ;
+    }
+
+
     static void BF_CDECL init_FILE_source( j_decompress_ptr const p_cinfo )
     {
         libjpeg_image & reader( get_reader( p_cinfo ) );
@@ -538,6 +670,55 @@ private:
     {
     }
 
+    static void BF_CDECL init_incremental_source( j_decompress_ptr /*p_cinfo*/ )
+    {
+    }
+
+    static boolean BF_CDECL fill_incremental_buffer( j_decompress_ptr const p_cinfo )
+    {
+        libjpeg_image & reader( get_reader( p_cinfo ) );
+
+        // Everything pushed so far is already visible through the source
+        // manager so getting here means the library has exhausted it: suspend
+        // (leaving next_input_byte/bytes_in_buffer untouched) unless the input
+        // is complete.
+        if ( !reader.input_complete_ )
+            return false;
+
+        WARNMS( p_cinfo, JWRN_JPEG_EOF );
+        static JOCTET const fake_eoi[ 2 ] = { 0xFF, JPEG_EOI };
+        reader.source_manager_.next_input_byte = fake_eoi;
+        reader.source_manager_.bytes_in_buffer = sizeof( fake_eoi );
+
+        return true;
+    }
+
+    static void BF_CDECL skip_incremental_data( j_decompress_ptr const p_cinfo, long const num_bytes )
+    {
+        if ( num_bytes <= 0 )
+            return;
+
+        libjpeg_image & reader( get_reader( p_cinfo ) );
+
+        std::size_t const bytes( static_cast<std::size_t>( num_bytes ) );
+        if ( bytes <= reader.source_manager_.bytes_in_buffer )
+        {
+            reader.source_manager_.next_input_byte += bytes;
+            reader.source_manager_.bytes_in_buffer -= bytes;
+        }
+        else
+        {
+            // The rest gets dropped from the data pushed next.
+            reader.bytes_to_skip_ += bytes - reader.source_manager_.bytes_in_buffer;
+            reader.source_manager_.next_input_byte += reader.source_manager_.bytes_in_buffer;
+            reader.source_manager_.bytes_in_buffer  = 0;
+        }
+    }
+
+    static void BF_CDECL term_incremental_source( j_decompress_ptr /*p_cinfo*/ )
+    {
+    }
+
     static libjpeg_image & get_reader(  j_decompress_ptr const p_cinfo )
     {
         libjpeg_image & reader( static_cast<libjpeg_image &>( base( gil_reinterpret_cast<j_common_ptr>( p_cinfo ) ) ) );
@@ -548,6 +729,10 @@ private:
 private:
     jpeg_source_mgr     source_manager_;
     array<JOCTET, 4096> read_buffer_   ;//...zzz...extract to a wrapper...not needed for in memory sources...
+
+    std::vector<JOCTET> incremental_buffer_;
+    std::size_t         bytes_to_skip_     ;
+    bool                input_complete_    ;
 }; // class libjpeg_reader
 
 #if defined( BOOST_MSVC )
@@ -26,7 +26,19 @@
 #include "boost/gil/extension/io2/detail/platform_specifics.hpp"
 #include "boost/gil/extension/io2/detail/shared.hpp"
 
+#include "boost/gil/extension/io2/detail/parallel.hpp"
+
 #include <boost/array.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/smart_ptr/scoped_array.hpp>
+
+#ifndef BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+    #include <csetjmp>
+#endif // BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <vector>
 //------------------------------------------------------------------------------
 namespace boost
 {
@@ -35,6 +47,565 @@ namespace gil
 {
 //------------------------------------------------------------------------------
 
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \class jpeg_writer_options
+///
+/// \brief Encoder settings used by libjpeg_writer::write_default() (and the
+/// streamed output).
+///
+/// Negative/default values select the LibJPEG defaults (jpeg_set_defaults()).
+///
+////////////////////////////////////////////////////////////////////////////////
+
+struct jpeg_writer_options
+{
+    /// Chroma (Cb and Cr) subsampling, relevant only for YCbCr/YCCK output.
+    enum subsampling_t
+    {
+        default_subsampling, ///< 4:2:0 for LibJPEG
+        subsampling_444    ,
+        subsampling_422    ,
+        subsampling_420    ,
+        subsampling_440
+    };
+
+    enum dct_method_t
+    {
+        default_dct = JDCT_DEFAULT,
+        islow       = JDCT_ISLOW  , ///< accurate integer
+        ifast       = JDCT_IFAST  , ///< fast, less accurate, integer
+        fp          = JDCT_FLOAT    ///< floating point
+    };
+
+    jpeg_writer_options()
+        :
+        quality         ( -1                  ),
+        subsampling     ( default_subsampling ),
+        optimize_coding ( false               ),
+        progressive     ( false               ),
+        restart_interval( 0                   ),
+        dct_method      ( default_dct         )
+    {}
+
+    int           quality         ; ///< [1, 100] (75 by default)
+    subsampling_t subsampling     ;
+    bool          optimize_coding ; ///< compute optimal Huffman tables (an extra pass over the coefficients)
+    bool          progressive     ; ///< the standard (jpeg_simple_progression()) scan script
+    unsigned int  restart_interval; ///< in MCU rows, zero for none
+    dct_method_t  dct_method      ;
+}; // struct jpeg_writer_options
+
+
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \class jpeg_lossless_transform
+///
+/// \brief A crop and/or a rotation/flip performed directly on the DCT
+/// coefficients (see libjpeg_writer::write_transformed()).
+///
+/// The crop (in source image pixels) is applied first. Its offset is rounded
+/// down to an iMCU boundary (and the dimensions enlarged accordingly). Zero
+/// crop dimensions extend the region to the right/bottom image edge. As in
+/// jpegtran -trim, partial iMCUs that the operation would move away from the
+/// right/bottom edge are dropped.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+struct jpeg_lossless_transform
+{
+    enum operation_t
+    {
+        no_operation   ,
+        flip_horizontal,
+        flip_vertical  ,
+        transpose      , ///< across the top-left/bottom-right diagonal
+        transverse     , ///< across the top-right/bottom-left diagonal
+        rotate_90      , ///< clockwise
+        rotate_180     ,
+        rotate_270
+    };
+
+    jpeg_lossless_transform( operation_t const operation_ = no_operation )
+        :
+        operation      ( operation_ ),
+        crop_offset    ( 0, 0       ),
+        crop_dimensions( 0, 0       )
+    {}
+
+    /// The operation that brings an image with the given EXIF orientation
+    /// (1 - 8) to the normal (top-left) orientation.
+    static jpeg_lossless_transform from_exif_orientation( unsigned int const orientation )
+    {
+        static operation_t const operations[] =
+        {
+            no_operation, no_operation, flip_horizontal, rotate_180, flip_vertical, transpose, rotate_90, transverse, rotate_270
+        };
+        return jpeg_lossless_transform( ( orientation < boost::size( operations ) ) ? operations[ orientation ] : no_operation );
+    }
+
+    operation_t          operation      ;
+    point2<unsigned int> crop_offset    ;
+    point2<unsigned int> crop_dimensions;
+}; // struct jpeg_lossless_transform
+
+
+namespace detail
+{
+//------------------------------------------------------------------------------
+
+// Implementation note:
+//   jpeg_set_defaults() resets all the parameters (and chooses the JPEG
+// colour space from in_color_space) so the options have to be applied after
+// it. libjpeg_writer::write() (without the defaults) leaves the parameters to
+// be configured by the user through lib_object().
+inline void set_jpeg_defaults( jpeg_compress_struct & cinfo, jpeg_writer_options const & options ) BOOST_GIL_CAN_THROW
+{
+    jpeg_set_defaults( &cinfo );
+
+    if ( options.quality >= 0 )
+        jpeg_set_quality( &cinfo, options.quality, true );
+
+    if
+    (
+        ( options.subsampling != jpeg_writer_options::default_subsampling ) &&
+        ( ( cinfo.jpeg_color_space == JCS_YCbCr ) || ( cinfo.jpeg_color_space == JCS_YCCK ) )
+    )
+    {
+        static int const factors[][ 2 ] = // { horizontal, vertical }
+        {
+            { 2, 2 }, // default
+            { 1, 1 }, // 4:4:4
+            { 2, 1 }, // 4:2:2
+            { 2, 2 }, // 4:2:0
+            { 1, 2 }  // 4:4:0
+        };
+        cinfo.comp_info[ 0 ].h_samp_factor = factors[ options.subsampling ][ 0 ];
+        cinfo.comp_info[ 0 ].v_samp_factor = factors[ options.subsampling ][ 1 ];
+        for ( int component( 1 ); component < cinfo.num_components; ++component )
+        {
+            cinfo.comp_info[ component ].h_samp_factor = 1;
+            cinfo.comp_info[ component ].v_samp_factor = 1;
+        }
+        // The K channel of YCCK is sampled like Y.
+        if ( cinfo.jpeg_color_space == JCS_YCCK )
+        {
+            cinfo.comp_info[ 3 ].h_samp_factor = cinfo.comp_info[ 0 ].h_samp_factor;
+            cinfo.comp_info[ 3 ].v_samp_factor = cinfo.comp_info[ 0 ].v_samp_factor;
+        }
+    }
+
+    cinfo.optimize_coding = options.optimize_coding;
+    cinfo.restart_in_rows = options.restart_interval;
+    cinfo.dct_method      = static_cast<J_DCT_METHOD>( options.dct_method );
+
+    if ( options.progressive )
+        jpeg_simple_progression( &cinfo );
+}
+
+
+inline unsigned int round_up_to_multiple( unsigned int const value, unsigned int const multiple ) { return ( value + multiple - 1 ) / multiple * multiple; }
+
+
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \class jpeg_block_mapping_t
+/// \internal
+/// \brief Maps the DCT blocks (and coefficients) of a lossless transform's
+/// target to those of the source.
+///
+/// Every operation is expressed as an optional transposition followed by
+/// optional mirroring of the source axes: for a target position (x, y) the
+/// source position is (x, y) or, if transposed, (y, x), with the source x
+/// and/or y coordinate then mirrored within the (cropped) source region.
+/// Mirroring negates the odd frequency coefficients along that axis.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+class jpeg_block_mapping_t
+{
+public:
+    jpeg_block_mapping_t( jpeg_decompress_struct const & src, jpeg_lossless_transform const & transform )
+        :
+        transpose_( false ), mirror_x_( false ), mirror_y_( false )
+    {
+        switch ( transform.operation )
+        {
+            case jpeg_lossless_transform::no_operation   :                                                     break;
+            case jpeg_lossless_transform::flip_horizontal:                     mirror_x_ = true;                  break;
+            case jpeg_lossless_transform::flip_vertical  :                                       mirror_y_ = true; break;
+            case jpeg_lossless_transform::transpose      : transpose_ = true;                                  break;
+            case jpeg_lossless_transform::transverse     : transpose_ = true;  mirror_x_ = true; mirror_y_ = true; break;
+            case jpeg_lossless_transform::rotate_90      : transpose_ = true;                    mirror_y_ = true; break;
+            case jpeg_lossless_transform::rotate_180     :                     mirror_x_ = true; mirror_y_ = true; break;
+            case jpeg_lossless_transform::rotate_270     : transpose_ = true;  mirror_x_ = true;                  break;
+            default: BF_UNREACHABLE_CODE
+        }
+
+        imcu_ = ( src.num_components == 1 )
+            ? point2<unsigned int>( DCTSIZE, DCTSIZE )
+            : point2<unsigned int>( src.max_h_samp_factor * DCTSIZE, src.max_v_samp_factor * DCTSIZE );
+
+        point2<unsigned int> const image( src.image_width, src.image_height );
+        io::detail::io_error_if( ( transform.crop_offset.x >= image.x ) || ( transform.crop_offset.y >= image.y ), "Crop region outside of the image." );
+        offset_ = point2<unsigned int>( transform.crop_offset.x / imcu_.x * imcu_.x, transform.crop_offset.y / imcu_.y * imcu_.y );
+        point2<unsigned int> const requested
+        (
+            transform.crop_dimensions.x ? transform.crop_dimensions.x : image.x,
+            transform.crop_dimensions.y ? transform.crop_dimensions.y : image.y
+        );
+        dimensions_.x = std::min( requested.x + ( transform.crop_offset.x - offset_.x ), image.x - offset_.x );
+        dimensions_.y = std::min( requested.y + ( transform.crop_offset.y - offset_.y ), image.y - offset_.y );
+
+        // Partial iMCUs cannot be moved away from the right/bottom edge.
+        if ( mirror_x_ ) dimensions_.x = dimensions_.x / imcu_.x * imcu_.x;
+        if ( mirror_y_ ) dimensions_.y = dimensions_.y / imcu_.y * imcu_.y;
+        io::detail::io_error_if( !dimensions_.x || !dimensions_.y, "Image too small for the lossless transform." );
+
+        for ( int component( 0 ); component < src.num_components; ++component )
+        {
+            jpeg_component_info const & info( src.comp_info[ component ] );
+            point2<unsigned int> const sampling( ( src.num_components == 1 ) ? 1 : info.h_samp_factor, ( src.num_components == 1 ) ? 1 : info.v_samp_factor );
+            source_offsets_[ component ] = point2<unsigned int>( offset_.x / imcu_.x * sampling.x, offset_.y / imcu_.y * sampling.y );
+            source_blocks_ [ component ] = point2<unsigned int>
+            (
+                ( dimensions_.x * sampling.x + imcu_.x - 1 ) / imcu_.x,
+                ( dimensions_.y * sampling.y + imcu_.y - 1 ) / imcu_.y
+            );
+            source_sampling_[ component ] = point2<unsigned int>( info.h_samp_factor, info.v_samp_factor );
+        }
+    }
+
+    bool transposed() const { return transpose_; }
+
+    point2<unsigned int> target_dimensions() const { return swapped( dimensions_ ); }
+
+    point2<unsigned int> target_blocks  ( int const component ) const { return swapped( source_blocks_  [ component ] ); }
+    point2<unsigned int> target_sampling( int const component ) const { return swapped( source_sampling_[ component ] ); }
+
+    void transform( jpeg_decompress_struct & src, int const component, jvirt_barray_ptr const source, jvirt_barray_ptr const target ) const
+    {
+        j_common_ptr           const p_common      ( gil_reinterpret_cast<j_common_ptr>( &src ) );
+        point2<unsigned int>   const target_blocks ( this->target_blocks( component ) );
+        point2<unsigned int>   const source_blocks ( source_blocks_ [ component ] );
+        point2<unsigned int>   const source_offset ( source_offsets_[ component ] );
+
+        for ( unsigned int target_y( 0 ); target_y < target_blocks.y; ++target_y )
+        {
+            JBLOCKROW const p_target_row( *src.mem->access_virt_barray( p_common, target, target_y, 1, true ) );
+            for ( unsigned int target_x( 0 ); target_x < target_blocks.x; ++target_x )
+            {
+                unsigned int source_x( transpose_ ? target_y : target_x );
+                unsigned int source_y( transpose_ ? target_x : target_y );
+                if ( mirror_x_ ) source_x = source_blocks.x - 1 - source_x;
+                if ( mirror_y_ ) source_y = source_blocks.y - 1 - source_y;
+
+                JBLOCKROW const p_source_row( *src.mem->access_virt_barray( p_common, source, source_offset.y + source_y, 1, false ) );
+                transform_block( p_source_row[ source_offset.x + source_x ], p_target_row[ target_x ] );
+            }
+        }
+    }
+
+private:
+    void transform_block( JBLOCK const & source, JBLOCK & target ) const
+    {
+        for ( unsigned int v( 0 ); v < DCTSIZE; ++v )
+        {
+            for ( unsigned int u( 0 ); u < DCTSIZE; ++u )
+            {
+                // Source horizontal and vertical frequencies.
+                unsigned int const p( transpose_ ? v : u );
+                unsigned int const q( transpose_ ? u : v );
+                JCOEF coefficient( source[ q * DCTSIZE + p ] );
+                if ( ( mirror_x_ && ( p & 1 ) ) != ( mirror_y_ && ( q & 1 ) ) )
+                    coefficient = -coefficient;
+                target[ v * DCTSIZE + u ] = coefficient;
+            }
+        }
+    }
+
+    point2<unsigned int> swapped( point2<unsigned int> const & value ) const
+    {
+        return transpose_ ? point2<unsigned int>( value.y, value.x ) : value;
+    }
+
+private:
+    bool                 transpose_;
+    bool                 mirror_x_ ;
+    bool                 mirror_y_ ;
+    point2<unsigned int> imcu_      ;
+    point2<unsigned int> offset_    ; ///< of the (cropped) source region, in pixels
+    point2<unsigned int> dimensions_; ///< of the (cropped and trimmed) source region, in pixels
+
+    point2<unsigned int> source_offsets_ [ MAX_COMPONENTS ]; ///< in blocks
+    point2<unsigned int> source_blocks_  [ MAX_COMPONENTS ];
+    point2<unsigned int> source_sampling_[ MAX_COMPONENTS ];
+}; // class jpeg_block_mapping_t
+
+
+/// A plane of already downsampled samples for raw data output.
+struct jpeg_raw_plane_t
+{
+    template <class View>
+    explicit jpeg_raw_plane_t( View const & view )
+        :
+        p_data( backend_base::get_raw_data( view ) ),
+        width ( view.width ()                      ),
+        height( view.height()                      ),
+        stride( view.pixels().row_size()           )
+    {
+        BOOST_STATIC_ASSERT( num_channels<View>::value == 1 );
+        BOOST_STATIC_ASSERT( sizeof( typename View::value_type ) == sizeof( JSAMPLE ) );
+    }
+
+    JSAMPLE      * p_data;
+    unsigned int   width ;
+    unsigned int   height;
+    unsigned int   stride;
+}; // struct jpeg_raw_plane_t
+
+
+/// MCU dimensions (in pixels) of the (single, interleaved or not) scan set up
+/// in cinfo.
+inline point2<unsigned int> jpeg_mcu_dimensions( jpeg_compress_struct const & cinfo )
+{
+    if ( cinfo.num_components == 1 )
+        return point2<unsigned int>( DCTSIZE, DCTSIZE );
+
+    int max_h_samp_factor( 1 );
+    int max_v_samp_factor( 1 );
+    for ( int component( 0 ); component < cinfo.num_components; ++component )
+    {
+        max_h_samp_factor = std::max( max_h_samp_factor, cinfo.comp_info[ component ].h_samp_factor );
+        max_v_samp_factor = std::max( max_v_samp_factor, cinfo.comp_info[ component ].v_samp_factor );
+    }
+    return point2<unsigned int>( max_h_samp_factor * DCTSIZE, max_v_samp_factor * DCTSIZE );
+}
+
+
+/// Offsets of the interesting parts of a (single scan) JPEG stream.
+struct jpeg_stream_layout_t
+{
+    BOOST_STATIC_CONSTANT( JOCTET, sof0 = 0xC0 );
+    BOOST_STATIC_CONSTANT( JOCTET, sof1 = 0xC1 );
+    BOOST_STATIC_CONSTANT( JOCTET, sos  = 0xDA );
+    BOOST_STATIC_CONSTANT( JOCTET, dri  = 0xDD );
+
+    explicit jpeg_stream_layout_t( std::vector<JOCTET> const & stream )
+        :
+        sof_marker( 0 ), sos_marker( 0 ), scan_data( 0 )
+    {
+        std::size_t position( 2 ); // SOI
+        while ( position + 4 <= stream.size() )
+        {
+            BOOST_ASSERT( stream[ position ] == 0xFF );
+            JOCTET      const marker( stream[ position + 1 ] );
+            std::size_t const length( ( stream[ position + 2 ] << 8 ) | stream[ position + 3 ] );
+            if ( ( marker == sof0 ) || ( marker == sof1 ) )
+                sof_marker = position;
+            if ( marker == sos )
+            {
+                sos_marker = position;
+                scan_data  = position + 2 + length;
+                break;
+            }
+            position += 2 + length;
+        }
+        io::detail::io_error_if( !sof_marker || !scan_data || ( scan_data + 2 > stream.size() ), "Unexpected LibJPEG output." );
+    }
+
+    std::size_t sof_marker;
+    std::size_t sos_marker;
+    std::size_t scan_data ; ///< start of the entropy coded data (which ends with the trailing EOI)
+}; // struct jpeg_stream_layout_t
+
+
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \class jpeg_stripe_encoder
+/// \internal
+/// \brief Compresses horizontal stripes of an image into complete, baseline,
+/// in-memory JPEG streams whose entropy coded data can be spliced together
+/// (see libjpeg_writer::write_in_stripes()).
+///
+/// Reports errors through the return value so that it can be used from
+/// parallel_for() workers.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+class jpeg_stripe_encoder : noncopyable
+{
+public:
+    jpeg_stripe_encoder()
+        :
+        created_ ( false ),
+        p_output_( 0     )
+    {
+        jpeg_std_error( &error_manager_.manager );
+        error_manager_.manager.error_exit     = &error_exit    ;
+        error_manager_.manager.output_message = &output_message;
+        cinfo_.err = &error_manager_.manager;
+
+        #ifdef BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+            try { jpeg_create_compress( &cinfo_ ); } catch ( ... ) { return; }
+        #else
+            if ( setjmp( error_manager_.target ) )
+                return;
+            jpeg_create_compress( &cinfo_ );
+        #endif // BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+        created_ = true;
+
+        cinfo_.client_data = this;
+        cinfo_.dest        = &destination_manager_;
+        destination_manager_.init_destination    = &init_destination   ;
+        destination_manager_.empty_output_buffer = &empty_output_buffer;
+        destination_manager_.term_destination    = &term_destination   ;
+    }
+
+    ~jpeg_stripe_encoder() { if ( created_ ) jpeg_destroy_compress( &cinfo_ ); }
+
+    bool encode
+    (
+        JSAMPLE                   * const p_first_row,
+        unsigned int                const width,
+        unsigned int                const height,
+        unsigned int                const stride,
+        unsigned int                const number_of_components,
+        J_COLOR_SPACE               const format,
+        jpeg_writer_options const &       options,
+        std::vector<JOCTET>       &       output
+    )
+    {
+        if ( !created_ )
+            return false;
+
+        p_output_ = &output;
+
+        #ifdef BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+            try
+            {
+        #else
+            if ( setjmp( error_manager_.target ) )
+            {
+                jpeg_abort_compress( &cinfo_ );
+                return false;
+            }
+        #endif // BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+
+        cinfo_.image_width      = width ;
+        cinfo_.image_height     = height;
+        cinfo_.input_components = number_of_components;
+        cinfo_.in_color_space   = format;
+        set_jpeg_defaults( cinfo_, options );
+        // Identical (standard) Huffman tables and a single entropy coded
+        // segment per stripe.
+        cinfo_.optimize_coding  = false;
+        cinfo_.restart_interval = 0;
+        cinfo_.restart_in_rows  = 0;
+
+        jpeg_start_compress( &cinfo_, true );
+        JSAMPROW rows[ 4 * DCTSIZE ];
+        while ( cinfo_.next_scanline < cinfo_.image_height )
+        {
+            unsigned int const batch( std::min<unsigned int>( boost::size( rows ), cinfo_.image_height - cinfo_.next_scanline ) );
+            for ( unsigned int row( 0 ); row < batch; ++row )
+                rows[ row ] = p_first_row + ( cinfo_.next_scanline + row ) * stride;
+            jpeg_write_scanlines( &cinfo_, rows, batch );
+        }
+        jpeg_finish_compress( &cinfo_ );
+
+        #ifdef BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+            }
+            catch ( ... )
+            {
+                jpeg_abort_compress( &cinfo_ );
+                return false;
+            }
+        #endif // BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+
+        return true;
+    }
+
+private:
+    struct error_manager_t
+    {
+        jpeg_error_mgr manager;
+    #ifndef BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+        jmp_buf        target ;
+    #endif // BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+    };
+
+    static jpeg_stripe_encoder & encoder( j_compress_ptr const p_cinfo ) { return *static_cast<jpeg_stripe_encoder *>( p_cinfo->client_data ); }
+
+    static void BF_CDECL error_exit( j_common_ptr const p_cinfo )
+    {
+        #ifdef BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+            ignore_unused_variable_warning( p_cinfo );
+            io::detail::io_error( "LibJPEG error" );
+        #else
+            longjmp( reinterpret_cast<error_manager_t *>( p_cinfo->err )->target, 1 );
+        #endif // BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+    }
+
+    static void BF_CDECL output_message( j_common_ptr /*p_cinfo*/ ) {}
+
+    // Implementation note:
+    //   The output buffer grows from within LibJPEG (on the worker threads) so
+    // an allocation failure is reported as a LibJPEG error (making encode()
+    // return false) rather than letting std::bad_alloc unwind through C code.
+    static void resize_output( j_compress_ptr const p_cinfo, std::size_t const size )
+    {
+        bool resized;
+        try
+        {
+            encoder( p_cinfo ).p_output_->resize( size );
+            resized = true;
+        }
+        catch ( std::bad_alloc const & )
+        {
+            resized = false;
+        }
+        if ( !resized )
+            p_cinfo->err->error_exit( gil_reinterpret_cast<j_common_ptr>( p_cinfo ) );
+    }
+
+    static void BF_CDECL init_destination( j_compress_ptr const p_cinfo )
+    {
+        jpeg_stripe_encoder & self( encoder( p_cinfo ) );
+        resize_output( p_cinfo, 64 * 1024 );
+        self.destination_manager_.next_output_byte = &( *self.p_output_ )[ 0 ];
+        self.destination_manager_.free_in_buffer   = self.p_output_->size();
+    }
+
+    static boolean BF_CDECL empty_output_buffer( j_compress_ptr const p_cinfo )
+    {
+        // Called only when the whole buffer is full.
+        jpeg_stripe_encoder & self( encoder( p_cinfo ) );
+        std::size_t const used( self.p_output_->size() );
+        resize_output( p_cinfo, used * 2 );
+        self.destination_manager_.next_output_byte = &( *self.p_output_ )[ used ];
+        self.destination_manager_.free_in_buffer   = self.p_output_->size() - used;
+        return true;
+    }
+
+    static void BF_CDECL term_destination( j_compress_ptr const p_cinfo )
+    {
+        jpeg_stripe_encoder & self( encoder( p_cinfo ) );
+        self.p_output_->resize( self.p_output_->size() - self.destination_manager_.free_in_buffer );
+    }
+
+private:
+    jpeg_compress_struct   cinfo_              ;
+    error_manager_t        error_manager_      ;
+    jpeg_destination_mgr   destination_manager_;
+    bool                   created_            ;
+    std::vector<JOCTET>  * p_output_           ;
+}; // class jpeg_stripe_encoder
+
+//------------------------------------------------------------------------------
+} // namespace detail
+
+
 class libjpeg_writer
     :
     public libjpeg_image,
@@ -46,26 +617,50 @@ protected:
 public:
     explicit libjpeg_writer( char const * const p_target_file_name )
         :
-        libjpeg_base( for_compressor() )
+        libjpeg_base( for_compressor() ),
+        number_of_threads_( 1 )
     {
         setup_destination( p_target_file_name );
     }
 
     explicit libjpeg_writer( FILE & file )
         :
-        libjpeg_base( for_compressor() )
+        libjpeg_base( for_compressor() ),
+        number_of_threads_( 1 )
     {
         setup_destination( file );
     }
 
     ~libjpeg_writer()
     {
-        jpeg_finish_compress( &compressor() );
+        // Already finished (or never started) streamed output needs no
+        // finishing and incomplete output cannot be finished.
+        if ( compressor().global_state == CSTATE_START )
+            return;
+        // (raw data output advances next_scanline in whole MCU rows)
+        if ( compressor().next_scanline >= compressor().image_height )
+            jpeg_finish_compress( &compressor() );
+        else
+        {
+            abort();
+            release_destination();
+        }
     }
 
     jpeg_compress_struct       & lib_object()       { return compressor(); }
     jpeg_compress_struct const & lib_object() const { return const_cast<libjpeg_writer &>( *this ).lib_object(); }
 
+    /// Encoder settings used by write_default() and begin().
+    void                        set_options( jpeg_writer_options const & options ) { options_ = options; }
+    jpeg_writer_options const &     options(                                     ) const { return options_; }
+
+    /// Maximum number of threads write_default() may use (zero selects the
+    /// number of available CPUs). With more than one thread the image is
+    /// encoded in independent horizontal stripes separated by restart markers
+    /// (overriding the restart_interval option). Progressive and
+    /// optimize_coding output is always encoded serially.
+    void set_number_of_threads( unsigned int const number_of_threads ) { number_of_threads_ = number_of_threads; }
+
     void write_default( view_data_t const & view ) BOOST_GIL_CAN_THROW //...zzz...a plain throw(...) would be enough here but it chokes GCC...
     {
         setup_compression( view );
@@ -74,10 +669,13 @@ public:
         if ( setjmp( libjpeg_base::error_handler_target() ) )
             libjpeg_base::throw_jpeg_error();
     #endif // BOOST_GIL_THROW_THROUGH_C_SUPPORTED
-        jpeg_set_defaults( &compressor() );
-        //jpeg_set_quality( &compressor(), 100, false );
+        setup_default_compression();
 
-        do_write( view );
+        unsigned int const stripe_mcu_rows( parallel_stripe_mcu_rows() );
+        if ( stripe_mcu_rows )
+            write_in_stripes( view, stripe_mcu_rows );
+        else
+            do_write( view );
     }
 
     void write( view_data_t const & view )
@@ -86,13 +684,337 @@ public:
         do_write         ( view );
     }
 
+public: /// \ingroup Lossless transforms
+    /// Writes the source JPEG (whose header has been read but which has not
+    /// been decoded) cropped, rotated and/or flipped without decoding it to
+    /// pixels (and without any recompression loss). Only the optimize_coding,
+    /// progressive and restart_interval options are applied (the quantization
+    /// tables and the subsampling come from the source). Markers (e.g. EXIF)
+    /// are not copied.
+    void write_transformed( libjpeg_image & source, jpeg_lossless_transform const & transform ) BOOST_GIL_CAN_THROW
+    {
+        jpeg_decompress_struct & src( source.decompressor() );
+        jpeg_compress_struct   & dst( compressor()          );
+        BOOST_ASSERT( src.global_state == DSTATE_READY );
+
+    #ifndef BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+        if ( setjmp( source.error_handler_target() ) )
+            libjpeg_base::throw_jpeg_error();
+        if ( setjmp( libjpeg_base::error_handler_target() ) )
+            libjpeg_base::throw_jpeg_error();
+    #endif // BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+
+        detail::jpeg_block_mapping_t const mapping( src, transform );
+
+        // The target coefficient arrays have to be requested before
+        // jpeg_read_coefficients() realizes all the virtual arrays.
+        jvirt_barray_ptr target_coefficients[ MAX_COMPONENTS ];
+        for ( int component( 0 ); component < src.num_components; ++component )
+        {
+            point2<unsigned int> const blocks  ( mapping.target_blocks( component ) );
+            point2<unsigned int> const sampling( mapping.target_sampling( component ) );
+            target_coefficients[ component ] = src.mem->request_virt_barray
+            (
+                gil_reinterpret_cast<j_common_ptr>( &src ),
+                JPOOL_IMAGE,
+                true,
+                detail::round_up_to_multiple( blocks.x, sampling.x ),
+                detail::round_up_to_multiple( blocks.y, sampling.y ),
+                sampling.y
+            );
+        }
+
+        jvirt_barray_ptr * const p_source_coefficients( jpeg_read_coefficients( &src ) );
+
+        jpeg_copy_critical_parameters( &src, &dst );
+        dst.image_width  = mapping.target_dimensions().x;
+        dst.image_height = mapping.target_dimensions().y;
+        if ( mapping.transposed() )
+        {
+            for ( int component( 0 ); component < dst.num_components; ++component )
+                std::swap( dst.comp_info[ component ].h_samp_factor, dst.comp_info[ component ].v_samp_factor );
+            for ( unsigned int table( 0 ); table < NUM_QUANT_TBLS; ++table )
+            {
+                JQUANT_TBL * const p_table( dst.quant_tbl_ptrs[ table ] );
+                if ( !p_table )
+                    continue;
+                for ( unsigned int v( 0 ); v < DCTSIZE; ++v )
+                    for ( unsigned int u( v + 1 ); u < DCTSIZE; ++u )
+                        std::swap( p_table->quantval[ v * DCTSIZE + u ], p_table->quantval[ u * DCTSIZE + v ] );
+            }
+        }
+        dst.optimize_coding = options_.optimize_coding;
+        dst.restart_in_rows = options_.restart_interval;
+        if ( options_.progressive )
+            jpeg_simple_progression( &dst );
+
+        for ( int component( 0 ); component < src.num_components; ++component )
+            mapping.transform( src, component, p_source_coefficients[ component ], target_coefficients[ component ] );
+
+        jpeg_write_coefficients( &dst, target_coefficients );
+        jpeg_finish_compress   ( &dst );
+        jpeg_finish_decompress ( &src );
+    }
+
+public: /// \ingroup Raw (planar, pre-subsampled, YCbCr) output
+    /// Compresses planar Y, Cb and Cr (8 bit, single channel) views directly
+    /// (with jpeg_write_raw_data()), skipping LibJPEG's colour conversion and
+    /// downsampling (e.g. YUV 4:2:0 video frames). The chroma subsampling is
+    /// deduced from the plane dimensions (1 or 2 in either direction) and
+    /// overrides the subsampling option.
+    template <class LumaView, class ChromaView>
+    void write_ycbcr( LumaView const & y, ChromaView const & cb, ChromaView const & cr )
+    {
+        detail::jpeg_raw_plane_t const planes[ 3 ] =
+        {
+            detail::jpeg_raw_plane_t( y  ),
+            detail::jpeg_raw_plane_t( cb ),
+            detail::jpeg_raw_plane_t( cr )
+        };
+        write_raw( planes );
+    }
+
+public: /// \ingroup Streaming (band by band) output
+    /// Starts compression of an image of the given dimensions and format (with
+    /// the options() settings). The rows are then passed with write_rows().
+    void begin( point2<unsigned int> const & dimensions, format_t const format ) BOOST_GIL_CAN_THROW
+    {
+        setup_compression( dimensions.x, dimensions.y, format_components( format ), format );
+
+    #ifndef BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+        if ( setjmp( libjpeg_base::error_handler_target() ) )
+            libjpeg_base::throw_jpeg_error();
+    #endif // BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+        setup_default_compression();
+        jpeg_start_compress( &compressor(), false );
+    }
+
+    /// Compresses the next band of rows (of the full image width).
+    void write_rows( view_data_t const & band ) BOOST_GIL_CAN_THROW
+    {
+        BOOST_ASSERT( band.width_  == compressor().image_width    );
+        BOOST_ASSERT( band.format_ == compressor().in_color_space );
+        BOOST_ASSERT( compressor().next_scanline + band.height_ <= compressor().image_height );
+
+    #ifndef BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+        if ( setjmp( libjpeg_base::error_handler_target() ) )
+            libjpeg_base::throw_jpeg_error();
+    #endif // BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+        write_rows( band.buffer_, band.height_, band.stride_ );
+    }
+
+    /// Flushes the remaining data (writes the EOI marker).
+    void finish() BOOST_GIL_CAN_THROW
+    {
+        io::detail::io_error_if( compressor().next_scanline != compressor().image_height, "Not all rows of the streamed JPEG image were written." );
+
+    #ifndef BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+        if ( setjmp( libjpeg_base::error_handler_target() ) )
+            libjpeg_base::throw_jpeg_error();
+    #endif // BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+        jpeg_finish_compress( &compressor() );
+    }
+
 private:
     void setup_compression( view_data_t const & view )
     {
-        compressor().image_width      = static_cast<JDIMENSION>( view.width_  );
-        compressor().image_height     = static_cast<JDIMENSION>( view.height_ );
-        compressor().input_components = view.number_of_channels_;
-        compressor().in_color_space   = view.format_;
+        setup_compression( view.width_, view.height_, view.number_of_channels_, view.format_ );
+    }
+
+    void setup_compression( unsigned int const width, unsigned int const height, unsigned int const number_of_components, format_t const format )
+    {
+        compressor().image_width      = static_cast<JDIMENSION>( width  );
+        compressor().image_height     = static_cast<JDIMENSION>( height );
+        compressor().input_components = number_of_components;
+        compressor().in_color_space   = format;
+    }
+
+    void setup_default_compression() BOOST_GIL_CAN_THROW
+    {
+        detail::set_jpeg_defaults( compressor(), options_ );
+    }
+
+    unsigned int threads() const { return number_of_threads_ ? number_of_threads_ : io::detail::hardware_concurrency(); }
+
+    /// The height of the stripes (in MCU rows) for parallel encoding (zero if
+    /// the image should be encoded serially).
+    unsigned int parallel_stripe_mcu_rows() const
+    {
+        jpeg_compress_struct const & cinfo( compressor() );
+        unsigned int const number_of_threads( threads() );
+        if ( ( number_of_threads < 2 ) || cinfo.optimize_coding || cinfo.scan_info || cinfo.arith_code )
+            return 0;
+
+        point2<unsigned int> const mcu        ( detail::jpeg_mcu_dimensions( cinfo ) );
+        unsigned int         const mcus_per_row( ( cinfo.image_width  + mcu.x - 1 ) / mcu.x );
+        unsigned int         const mcu_rows    ( ( cinfo.image_height + mcu.y - 1 ) / mcu.y );
+
+        // The restart interval (the number of MCUs in a stripe) is a 16 bit
+        // value. A few stripes per thread give some load balancing.
+        unsigned int const max_stripe_mcu_rows( 65535 / mcus_per_row );
+        unsigned int const stripe_mcu_rows
+        (
+            std::min( max_stripe_mcu_rows, std::max( 1U, mcu_rows / ( number_of_threads * 4 ) ) )
+        );
+        if ( !stripe_mcu_rows || ( stripe_mcu_rows >= mcu_rows ) )
+            return 0;
+        return stripe_mcu_rows;
+    }
+
+    // Implementation note:
+    //   Each stripe (a whole number of MCU rows) is compressed into a separate
+    // in-memory JPEG stream (with identical, standard, tables). A restart
+    // marker resets the DC predictions and byte aligns the entropy coder just
+    // as a fresh compressor does so the entropy coded segments of the stripes
+    // can be joined with RSTn markers under the header of the first stripe
+    // (with the height in the SOF patched and a DRI, defining one restart
+    // interval per stripe, inserted). Stripes are encoded in batches so that
+    // only a few compressed stripes are held in memory at once.
+    //   The compressor itself is never started here so neither
+    // jpeg_finish_compress() nor the destructor terminate the destination:
+    // on failure it has to be released explicitly.
+    void write_in_stripes( view_data_t const & view, unsigned int const stripe_mcu_rows ) BOOST_GIL_CAN_THROW
+    {
+    #ifndef BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+        if ( setjmp( libjpeg_base::error_handler_target() ) )
+        {
+            release_destination();
+            libjpeg_base::throw_jpeg_error();
+        }
+    #endif // BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+        try
+        {
+            encode_stripes( view, stripe_mcu_rows );
+        }
+        catch ( ... )
+        {
+            release_destination();
+            throw;
+        }
+    }
+
+    void encode_stripes( view_data_t const & view, unsigned int const stripe_mcu_rows ) BOOST_GIL_CAN_THROW
+    {
+        jpeg_compress_struct const & cinfo( compressor() );
+
+        point2<unsigned int> const mcu              ( detail::jpeg_mcu_dimensions( cinfo ) );
+        unsigned int         const mcus_per_row     ( ( cinfo.image_width + mcu.x - 1 ) / mcu.x );
+        unsigned int         const restart_interval ( mcus_per_row * stripe_mcu_rows );
+        unsigned int         const stripe_height    ( stripe_mcu_rows * mcu.y );
+        unsigned int         const number_of_stripes( ( view.height_ + stripe_height - 1 ) / stripe_height );
+        unsigned int         const number_of_threads( threads() );
+        unsigned int         const batch_size       ( std::min( number_of_threads * 2, number_of_stripes ) );
+
+        scoped_array<detail::jpeg_stripe_encoder> const encoders( new detail::jpeg_stripe_encoder[ number_of_threads ] );
+        std::vector<std::vector<JOCTET> >               outputs ( batch_size );
+        scoped_array<bool>                        const results ( new bool[ batch_size ] );
+
+        stripe_worker_t worker =
+        {
+            &view, stripe_height, 0, &options_, encoders.get(), &outputs[ 0 ], results.get()
+        };
+
+        destination_manager_.init_destination( &compressor() );
+
+        for ( unsigned int first_stripe( 0 ); first_stripe < number_of_stripes; first_stripe += batch_size )
+        {
+            unsigned int const stripes( std::min( batch_size, number_of_stripes - first_stripe ) );
+            worker.first_stripe = first_stripe;
+            io::detail::parallel_for( stripes, number_of_threads, worker );
+
+            for ( unsigned int stripe( 0 ); stripe < stripes; ++stripe )
+            {
+                io::detail::io_error_if( !results[ stripe ], "LibJPEG error" );
+
+                std::vector<JOCTET> & stream( outputs[ stripe ] );
+                detail::jpeg_stream_layout_t const layout( stream );
+                unsigned int const stripe_index( first_stripe + stripe );
+                if ( stripe_index == 0 )
+                {
+                    stream[ layout.sof_marker + 5 ] = static_cast<JOCTET>( cinfo.image_height >> 8 );
+                    stream[ layout.sof_marker + 6 ] = static_cast<JOCTET>( cinfo.image_height      );
+                    JOCTET const dri[] =
+                    {
+                        0xFF, detail::jpeg_stream_layout_t::dri, 0, 4,
+                        static_cast<JOCTET>( restart_interval >> 8 ), static_cast<JOCTET>( restart_interval )
+                    };
+                    emit( &stream[ 0 ], layout.sos_marker );
+                    emit( dri         , sizeof( dri )     );
+                    emit( &stream[ layout.sos_marker ], layout.scan_data - layout.sos_marker );
+                }
+                else
+                {
+                    JOCTET const rst[] = { 0xFF, static_cast<JOCTET>( JPEG_RST0 + ( ( stripe_index - 1 ) % 8 ) ) };
+                    emit( rst, sizeof( rst ) );
+                }
+                // Everything up to the trailing EOI.
+                emit( &stream[ layout.scan_data ], stream.size() - 2 - layout.scan_data );
+            }
+        }
+
+        JOCTET const eoi[] = { 0xFF, JPEG_EOI };
+        emit( eoi, sizeof( eoi ) );
+        destination_manager_.term_destination( &compressor() );
+    }
+
+    struct stripe_worker_t
+    {
+        void operator()( unsigned int const stripe, unsigned int const worker ) const
+        {
+            unsigned int const first_row( ( first_stripe + stripe ) * stripe_height );
+            results[ stripe ] = encoders[ worker ].encode
+            (
+                p_view->buffer_ + first_row * p_view->stride_,
+                p_view->width_,
+                std::min( stripe_height, p_view->height_ - first_row ),
+                p_view->stride_,
+                p_view->number_of_channels_,
+                p_view->format_,
+                *p_options,
+                outputs[ stripe ]
+            );
+        }
+
+        view_data_t                 const * p_view       ;
+        unsigned int                        stripe_height;
+        unsigned int                        first_stripe ;
+        jpeg_writer_options         const * p_options    ;
+        detail::jpeg_stripe_encoder       * encoders     ;
+        std::vector<JOCTET>               * outputs      ;
+        bool                              * results      ;
+    }; // struct stripe_worker_t
+
+    /// Passes already compressed data through the destination manager.
+    void emit( JOCTET const * p_data, std::size_t size ) BOOST_GIL_CAN_THROW
+    {
+        while ( size )
+        {
+            if ( !destination_manager_.free_in_buffer )
+                destination_manager_.empty_output_buffer( &compressor() );
+            std::size_t const chunk( std::min( size, destination_manager_.free_in_buffer ) );
+            std::memcpy( destination_manager_.next_output_byte, p_data, chunk );
+            destination_manager_.next_output_byte += chunk;
+            destination_manager_.free_in_buffer   -= chunk;
+            p_data += chunk;
+            size   -= chunk;
+        }
+    }
+
+    static unsigned int format_components( format_t const format )
+    {
+        switch ( format )
+        {
+            case JCS_GRAYSCALE: return 1;
+            case JCS_RGB      :
+            case JCS_YCbCr    : return 3;
+            case JCS_CMYK     :
+            case JCS_YCCK     : return 4;
+
+            default:
+                BOOST_ASSERT( !"Invalid or unknown format specified." );
+                BF_UNREACHABLE_CODE
+                return 0;
+        }
     }
 
     void do_write( view_data_t const & view ) BOOST_GIL_CAN_THROW
@@ -106,18 +1028,113 @@ private:
         
         jpeg_start_compress( &compressor(), false );
 
-        JSAMPLE *       p_row( view.buffer_ );
-        JSAMPLE * const p_end( memunit_advanced( view.buffer_, view.height_ * view.stride_ ) );
-        while ( p_row < p_end )
+        write_rows( view.buffer_, view.height_, view.stride_ );
+    }
+
+    // Implementation note:
+    //   LibJPEG downsamples and compresses whole MCU rows (max_v_samp_factor *
+    // DCTSIZE scanlines, e.g. 16 for 4:2:0) at a time so the rows are passed
+    // in batches of that size to avoid the per call overhead and internal
+    // (row by row) buffering.
+    // Implementation note:
+    //   Raw data is passed in whole iMCU rows and LibJPEG reads all of the
+    // samples of every (even partially) covered DCT block, i.e. up to
+    // DCTSIZE - 1 samples/rows past the plane edges. Rows past the bottom edge
+    // are therefore mapped to the last row and rows whose width is not block
+    // aligned are copied, with their last sample replicated, into a scratch
+    // buffer (instead of reading past the end of the caller's rows).
+    void write_raw( detail::jpeg_raw_plane_t const planes[ 3 ] ) BOOST_GIL_CAN_THROW
+    {
+        unsigned int const h_factor( ( planes[ 0 ].width  + planes[ 1 ].width  - 1 ) / planes[ 1 ].width  );
+        unsigned int const v_factor( ( planes[ 0 ].height + planes[ 1 ].height - 1 ) / planes[ 1 ].height );
+        io::detail::io_error_if
+        (
+            ( h_factor < 1 ) || ( h_factor > 2 ) || ( v_factor < 1 ) || ( v_factor > 2 )         ||
+            ( planes[ 1 ].width  != ( planes[ 0 ].width  + h_factor - 1 ) / h_factor )            ||
+            ( planes[ 1 ].height != ( planes[ 0 ].height + v_factor - 1 ) / v_factor )            ||
+            ( planes[ 2 ].width  != planes[ 1 ].width ) || ( planes[ 2 ].height != planes[ 1 ].height ),
+            "Unsupported YCbCr plane dimensions."
+        );
+
+        setup_compression( planes[ 0 ].width, planes[ 0 ].height, 3, JCS_YCbCr );
+
+    #ifndef BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+        if ( setjmp( libjpeg_base::error_handler_target() ) )
+            libjpeg_base::throw_jpeg_error();
+    #endif // BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+
+        jpeg_compress_struct & cinfo( compressor() );
+        setup_default_compression();
+        BOOST_ASSERT( cinfo.jpeg_color_space == JCS_YCbCr );
+        cinfo.comp_info[ 0 ].h_samp_factor = h_factor;
+        cinfo.comp_info[ 0 ].v_samp_factor = v_factor;
+        for ( unsigned int component( 1 ); component < 3; ++component )
+        {
+            cinfo.comp_info[ component ].h_samp_factor = 1;
+            cinfo.comp_info[ component ].v_samp_factor = 1;
+        }
+        cinfo.raw_data_in = true;
+
+        jpeg_start_compress( &cinfo, true );
+
+        JSAMPROW                 rows   [ 3 ][ MAX_SAMP_FACTOR * DCTSIZE ];
+        JSAMPARRAY               image  [ 3 ] = { rows[ 0 ], rows[ 1 ], rows[ 2 ] };
+        std::vector<JSAMPLE>     scratch[ 3 ];
+        for ( unsigned int component( 0 ); component < 3; ++component )
+        {
+            jpeg_component_info const & info( cinfo.comp_info[ component ] );
+            unsigned int const padded_width( info.width_in_blocks * DCTSIZE );
+            if ( padded_width != planes[ component ].width )
+                scratch[ component ].resize( padded_width * info.v_samp_factor * DCTSIZE );
+        }
+
+        unsigned int const imcu_row_height( cinfo.max_v_samp_factor * DCTSIZE );
+        for ( unsigned int imcu_row( 0 ); cinfo.next_scanline < cinfo.image_height; ++imcu_row )
         {
-            write_row( p_row );
-            memunit_advance( p_row, view.stride_ );
+            for ( unsigned int component( 0 ); component < 3; ++component )
+            {
+                jpeg_component_info      const & info        ( cinfo.comp_info[ component ] );
+                detail::jpeg_raw_plane_t const & plane       ( planes         [ component ] );
+                unsigned int             const   plane_rows  ( info.v_samp_factor * DCTSIZE  );
+                unsigned int             const   padded_width( info.width_in_blocks * DCTSIZE );
+                for ( unsigned int row( 0 ); row < plane_rows; ++row )
+                {
+                    unsigned int const source_row( std::min( imcu_row * plane_rows + row, plane.height - 1 ) );
+                    JSAMPLE * const p_source( plane.p_data + source_row * plane.stride );
+                    if ( scratch[ component ].empty() )
+                    {
+                        rows[ component ][ row ] = p_source;
+                        continue;
+                    }
+                    JSAMPLE * const p_padded( &scratch[ component ][ row * padded_width ] );
+                    std::memcpy( p_padded, p_source, plane.width );
+                    std::fill( p_padded + plane.width, p_padded + padded_width, p_source[ plane.width - 1 ] );
+                    rows[ component ][ row ] = p_padded;
+                }
+            }
+            BOOST_VERIFY( jpeg_write_raw_data( &cinfo, image, imcu_row_height ) == imcu_row_height );
         }
     }
 
-    void write_row( JSAMPLE * p_row ) BOOST_GIL_CAN_THROW
+    void write_rows( JSAMPLE * p_row, unsigned int number_of_rows, unsigned int const stride ) BOOST_GIL_CAN_THROW
     {
-        BOOST_VERIFY( jpeg_write_scanlines( &compressor(), &p_row, 1 ) == 1 );
+        BOOST_ASSERT( compressor().global_state == CSTATE_SCANNING );
+
+        JSAMPROW     rows[ MAX_SAMP_FACTOR * DCTSIZE ];
+        unsigned int const mcu_row_height( compressor().max_v_samp_factor * DCTSIZE );
+        BOOST_ASSERT( mcu_row_height <= boost::size( rows ) );
+
+        while ( number_of_rows )
+        {
+            unsigned int const batch( std::min( mcu_row_height, number_of_rows ) );
+            for ( unsigned int row( 0 ); row < batch; ++row )
+            {
+                rows[ row ] = p_row;
+                memunit_advance( p_row, stride );
+            }
+            BOOST_VERIFY( jpeg_write_scanlines( &compressor(), rows, batch ) == batch );
+            number_of_rows -= batch;
+        }
     }
 
     static libjpeg_writer & get_writer( j_compress_ptr const p_cinfo )
@@ -162,6 +1179,14 @@ private:
         destination_manager_.term_destination    = &term_and_close_fd_destination;
     }
 
+    /// Closes (without flushing) a file destination that LibJPEG will not
+    /// terminate (after a failed or aborted write).
+    void release_destination()
+    {
+        if ( destination_manager_.term_destination == &term_and_close_fd_destination )
+            BOOST_VERIFY( /*std*/::close( static_cast<int>( reinterpret_cast<std::intptr_t>( compressor().client_data ) ) ) == 0 );
+    }
+
     static void BF_CDECL init_destination( j_compress_ptr const p_cinfo )
     {
         libjpeg_writer & writer( get_writer( p_cinfo ) );
@@ -249,6 +1274,9 @@ private:
 private:
     jpeg_destination_mgr        destination_manager_;
     array<unsigned char, 65536> write_buffer_       ;
+
+    jpeg_writer_options         options_            ;
+    unsigned int                number_of_threads_  ;
 }; // class libjpeg_writer
 
 //------------------------------------------------------------------------------
@@ -24,6 +24,9 @@
 #include "detail/libx_shared.hpp"
 #include "detail/shared.hpp"
 
+#include "boost/gil/gray_alpha.hpp"
+#include "boost/gil/image.hpp"
+
 #include "boost/scoped_array.hpp"
 
 #include "png.h"
@@ -38,6 +41,14 @@ namespace boost
 //------------------------------------------------------------------------------
 namespace gil
 {
+//------------------------------------------------------------------------------
+
+/// Packed (sub-byte) gray images, matching the in-memory layout of 1, 2 and 4
+/// bit gray PNG rows (e.g. masks) so they can be read without expansion.
+typedef bit_aligned_image1_type<1, gray_layout_t>::type gray1_image_t;
+typedef bit_aligned_image1_type<2, gray_layout_t>::type gray2_image_t;
+typedef bit_aligned_image1_type<4, gray_layout_t>::type gray4_image_t;
+
 //------------------------------------------------------------------------------
 namespace detail
 {
@@ -56,6 +67,19 @@ template <> struct gil_to_libpng_format<rgb16_pixel_t , false> : mpl::integral_c
 template <> struct gil_to_libpng_format<rgba16_pixel_t, false> : mpl::integral_c<unsigned int, PNG_COLOR_TYPE_RGB_ALPHA | ( 16 << 16 )> {};
 template <> struct gil_to_libpng_format<gray16_pixel_t, false> : mpl::integral_c<unsigned int, PNG_COLOR_TYPE_GRAY      | ( 16 << 16 )> {};
 
+template <> struct gil_to_libpng_format<gray_alpha8_pixel_t , false> : mpl::integral_c<unsigned int, PNG_COLOR_TYPE_GRAY_ALPHA | (  8 << 16 )> {};
+template <> struct gil_to_libpng_format<gray_alpha16_pixel_t, false> : mpl::integral_c<unsigned int, PNG_COLOR_TYPE_GRAY_ALPHA | ( 16 << 16 )> {};
+
+// Implementation note:
+//   The packed gray formats are deliberately not listed in
+// libpng_supported_pixel_formats (the generic and in-place conversion paths
+// work with plain pixel pointers and references) so they are only ever read
+// directly, through the builtin (raw) path, from a gray PNG of the same bit
+// depth.
+template <> struct gil_to_libpng_format<gray1_image_t::view_t::value_type, false> : mpl::integral_c<unsigned int, PNG_COLOR_TYPE_GRAY | ( 1 << 16 )> {};
+template <> struct gil_to_libpng_format<gray2_image_t::view_t::value_type, false> : mpl::integral_c<unsigned int, PNG_COLOR_TYPE_GRAY | ( 2 << 16 )> {};
+template <> struct gil_to_libpng_format<gray4_image_t::view_t::value_type, false> : mpl::integral_c<unsigned int, PNG_COLOR_TYPE_GRAY | ( 4 << 16 )> {};
+
 
 template <typename Pixel, bool IsPlanar>
 struct libpng_is_supported : mpl::bool_<gil_to_libpng_format<Pixel, IsPlanar>::value != -1> {};
@@ -64,14 +88,16 @@ template <typename View>
 struct libpng_is_view_supported : libpng_is_supported<typename View::value_type, is_planar<View>::value> {};
 
 
-typedef mpl::vector6
+typedef mpl::vector8
 <
-    image<rgb8_pixel_t  , false>,
-    image<rgba8_pixel_t , false>,
-    image<gray8_pixel_t , false>,
-    image<rgb16_pixel_t , false>,
-    image<rgba16_pixel_t, false>,
-    image<gray16_pixel_t, false>
+    image<rgb8_pixel_t        , false>,
+    image<rgba8_pixel_t       , false>,
+    image<gray8_pixel_t       , false>,
+    image<rgb16_pixel_t       , false>,
+    image<rgba16_pixel_t      , false>,
+    image<gray16_pixel_t      , false>,
+    image<gray_alpha8_pixel_t , false>,
+    image<gray_alpha16_pixel_t, false>
 > libpng_supported_pixel_formats;
 
 
@@ -86,11 +112,11 @@ struct libpng_view_data_t
     /*explicit*/ libpng_view_data_t( View const & view, libpng_roi::offset_t const offset = 0 )
         :
         format_( gil_to_libpng_format<typename View::value_type, is_planar<View>::value>::value ),
-        buffer_( backend_base::get_raw_data( view ) ),
+        buffer_( raw_data( view, is_pointer<typename View::x_iterator>() ) ),
         offset_( offset                   ),
         height_( view.height()            ),
         width_ ( view.width ()            ),
-        stride_( view.pixels().row_size() ),
+        stride_( view.pixels().row_size() / byte_to_memunit<typename View::x_iterator>::value ),
         number_of_channels_( num_channels<View>::value )
     {
         BOOST_STATIC_ASSERT( libpng_is_view_supported<View>::value );
@@ -106,6 +132,20 @@ struct libpng_view_data_t
     unsigned int const width_ ;
     unsigned int const stride_;
     unsigned int const number_of_channels_;
+
+private:
+    template <class View>
+    static png_byte * raw_data( View const & view, mpl::true_ /*plain pixel pointer*/ )
+    {
+        return io::detail::backend_base::get_raw_data( view );
+    }
+
+    template <class View>
+    static png_byte * raw_data( View const & view, mpl::false_ /*packed (bit aligned) pixels*/ )
+    {
+        BOOST_ASSERT( view.row_begin( 0 ).bit_range().bit_offset() == 0 );
+        return const_cast<png_byte *>( view.row_begin( 0 ).bit_range().current_byte() );
+    }
 };
 
 
@@ -294,8 +334,8 @@ public: /// \ingroup Information
         {
             default: return current_format;
 
-            case PNG_COLOR_TYPE_PALETTE   : return PNG_COLOR_TYPE_RGB  | (                                   8 << 16 ); // 8-bit RGB
-            case PNG_COLOR_TYPE_GRAY_ALPHA: return PNG_COLOR_TYPE_RGBA | ( ( ( current_format >> 16 ) & 0xFF ) << 16 ); // (bits of current_format) RGBA
+            case PNG_COLOR_TYPE_PALETTE: return PNG_COLOR_TYPE_RGB  | ( 8 << 16 ); // 8-bit RGB (see palette() and copy_indices_to() for native access)
+            case PNG_COLOR_TYPE_GRAY   : return ( format_bit_depth( current_format ) < 8 ) ? ( PNG_COLOR_TYPE_GRAY | ( 8 << 16 ) ) : current_format; // sub-byte gray expands to 8-bit gray
         }
     }
 
@@ -313,6 +353,8 @@ public: /// \ingroup Information
 			case PNG_COLOR_TYPE_RGB       | ( 16 << 16 ) : return 3;
 			case PNG_COLOR_TYPE_RGB_ALPHA | ( 16 << 16 ) : return 4;
 			case PNG_COLOR_TYPE_GRAY      | ( 16 << 16 ) : return 5;
+			case PNG_COLOR_TYPE_GRAY_ALPHA| (  8 << 16 ) : return 6;
+			case PNG_COLOR_TYPE_GRAY_ALPHA| ( 16 << 16 ) : return 7;
 
 			default:
 				return unsupported_format;
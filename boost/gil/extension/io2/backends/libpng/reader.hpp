@@ -22,6 +22,7 @@
 #include "detail/platform_specifics.hpp"
 #include "detail/io_error.hpp"
 #include "detail/libx_shared.hpp"
+#include "detail/scratch_arena.hpp"
 #include "detail/shared.hpp"
 
 #include "boost/scoped_array.hpp"
@@ -32,6 +33,7 @@
     #include <csetjmp>
 #endif // BOOST_GIL_THROW_THROUGH_C_SUPPORTED
 #include <cstdlib>
+#include <vector>
 //------------------------------------------------------------------------------
 namespace boost
 {
@@ -88,6 +90,70 @@ public: // Low-level (row, strip, tile) access
         read_row( p_row_storage );
     }
 
+public: /// \ingroup Palette
+    typedef std::vector<rgba8_pixel_t> palette_t;
+
+    bool has_palette() const { return format_colour_type( format() ) == PNG_COLOR_TYPE_PALETTE; }
+
+    /// Returns the palette of a colour type 3 image with the tRNS chunk merged
+    /// in as the alpha channel (fully opaque entries where it is missing).
+    palette_t palette() const
+    {
+        BOOST_ASSERT( has_palette() );
+
+        png_colorp p_colours        ( 0 );
+        int        number_of_colours( 0 );
+        ::png_get_PLTE( &png_object(), &info_object(), &p_colours, &number_of_colours );
+
+        png_bytep  p_alphas         ( 0 );
+        int        number_of_alphas ( 0 );
+        if ( ::png_get_valid( &png_object(), &info_object(), PNG_INFO_tRNS ) )
+            ::png_get_tRNS( &png_object(), &info_object(), &p_alphas, &number_of_alphas, NULL );
+
+        palette_t palette( number_of_colours );
+        for ( int entry( 0 ); entry < number_of_colours; ++entry )
+        {
+            png_color const & colour( p_colours[ entry ] );
+            palette[ entry ] = rgba8_pixel_t
+            (
+                colour.red,
+                colour.green,
+                colour.blue,
+                ( entry < number_of_alphas ) ? p_alphas[ entry ] : 0xFF
+            );
+        }
+        return palette;
+    }
+
+    /// Reads the raw palette indices of a colour type 3 image (the
+    /// counterpart of palette()) into an 8-bit gray view (sub-byte indices are
+    /// unpacked) or into a packed gray view of the same bit depth as the image
+    /// (e.g. gray4_image_t for a 16 colour image). An offset view may be used
+    /// to read the image in bands.
+    template <class View>
+    void copy_indices_to( View const & view ) const
+    {
+        BOOST_STATIC_ASSERT( num_channels<typename get_original_view_t<View>::type>::value == 1 );
+
+        io::detail::io_error_if( !has_palette(), "Not a palette based PNG image." );
+
+        detail::libpng_view_data_t const view_data( get_view_data( view ) );
+        BOOST_ASSERT( view_data.width_                     == static_cast<unsigned int>( dimensions().x ) );
+        BOOST_ASSERT( view_data.offset_ + view_data.height_ <= static_cast<unsigned int>( dimensions().y ) );
+
+        unsigned int const index_bit_depth( format_bit_depth( view_data.format_ ) );
+        io::detail::io_error_if( ( index_bit_depth != 8 ) && ( index_bit_depth != bit_depth() ), "Palette index bit depth mismatch." );
+
+        if ( !read_started() )
+        {
+            if ( index_bit_depth != bit_depth() )
+                ::png_set_packing( &png_object() );
+            update_info();
+        }
+
+        read_rows( view_data );
+    }
+
 private: // Private backend_base interface.
     // Implementation note:
     //   MSVC 10 accepts friend base_t and friend class base_t, Clang 2.8
@@ -101,129 +167,222 @@ private: // Private backend_base interface.
     {
         using namespace detail;
 
-        std::size_t            const row_length  ( ::png_get_rowbytes( &png_object(), &info_object() ) );
-        scoped_array<png_byte> const p_row_buffer( new png_byte[ row_length ]                          );
+        if ( !read_started() )
+            setup_transformations( closest_gil_supported_format() );
+
+        std::size_t              const row_length  ( ::png_get_rowbytes( &png_object(), &info_object() ) );
+        io::detail::scratch_buffer<png_byte> const p_row_buffer( row_length                              );
 
         #ifndef BOOST_GIL_THROW_THROUGH_C_SUPPORTED
             if ( setjmp( error_handler_target() ) )
                 detail::throw_libpng_error();
         #endif // BOOST_GIL_THROW_THROUGH_C_SUPPORTED
 
-        unsigned int number_of_passes( ::png_set_interlace_handling( &png_object() ) );
-        BF_ASSUME( ( number_of_passes == 1 ) || ( number_of_passes == 7 ) );
-        BOOST_ASSERT( ( number_of_passes == 1 ) && "Missing interlaced support for the generic conversion case." );
-        ignore_unused_variable_warning( number_of_passes );
+        unsigned int const first_row   ( is_offset_view<TargetView>::value ? get_offset<offset_t>( view ) : 0 );
+        unsigned int const rows_to_read( original_view( view ).dimensions().y );
+
+        if ( number_of_passes() != 1 )
+        {
+            // Implementation note:
+            //   Adam7 interlaced images have to be decoded completely before
+            // any row can be converted so we combine all the passes into a
+            // native-format scratch image spanning only the target rows and
+            // then convert it in a single sweep.
+            io::detail::scratch_buffer<png_byte> const p_image( rows_to_read * row_length );
+            read_interlaced_rows( p_image.get(), row_length, first_row, rows_to_read );
+
+            for ( unsigned int row_index( 0 ); row_index < rows_to_read; ++row_index )
+            {
+                png_byte const * const p_row( p_image.get() + row_index * row_length );
+                convert_row<MyView>( p_row, p_row + row_length, original_view( view ).row_begin( row_index ), converter );
+            }
+            return;
+        }
 
         if ( is_offset_view<TargetView>::value )
-            skip_rows( get_offset<offset_t>( view ) );
+            skip_rows( first_row );
 
         png_byte       * const p_row    ( p_row_buffer.get() );
         png_byte const * const p_row_end( p_row + row_length );
 
-        unsigned int const rows_to_read( original_view( view ).dimensions().y );
         for ( unsigned int row_index( 0 ); row_index < rows_to_read; ++row_index )
         {
             read_row( p_row );
+            convert_row<MyView>( p_row, p_row_end, original_view( view ).row_begin( row_index ), converter );
+        }
+    }
 
-            typedef typename MyView::value_type pixel_t;
-            typedef typename get_original_view_t<TargetView>::type::x_iterator x_iterator;
+    template <class MyView, class TargetXIterator, class Converter>
+    static void convert_row( png_byte const * const p_row, png_byte const * const p_row_end, TargetXIterator p_target_pixel, Converter const & converter )
+    {
+        typedef typename MyView::value_type pixel_t;
 
-            pixel_t    const * p_source_pixel( gil_reinterpret_cast_c<pixel_t const *>( p_row ) );
-            x_iterator         p_target_pixel( original_view( view ).row_begin( row_index )     );
-            while ( p_source_pixel < gil_reinterpret_cast_c<pixel_t const *>( p_row_end ) )
-            {
-                converter( *p_source_pixel, *p_target_pixel );
-                ++p_source_pixel;
-                ++p_target_pixel;
-            }
+        pixel_t const * p_source_pixel( gil_reinterpret_cast_c<pixel_t const *>( p_row ) );
+        while ( p_source_pixel < gil_reinterpret_cast_c<pixel_t const *>( p_row_end ) )
+        {
+            converter( *p_source_pixel, *p_target_pixel );
+            ++p_source_pixel;
+            ++p_target_pixel;
         }
     }
 
     void raw_convert_to_prepared_view( detail::libpng_view_data_t const & view_data ) const
     {
-        BOOST_ASSERT( view_data.width_  == static_cast<unsigned int>( dimensions().x ) );
-        BOOST_ASSERT( view_data.height_ == static_cast<unsigned int>( dimensions().y ) );
-        BOOST_ASSERT( view_data.format_ == static_cast<unsigned int>( closest_gil_supported_format() ) );
+        BOOST_ASSERT( view_data.width_                     == static_cast<unsigned int>( dimensions().x ) );
+        BOOST_ASSERT( view_data.offset_ + view_data.height_ <= static_cast<unsigned int>( dimensions().y ) );
+
+        // Subsequent (ROI) reads continue with the already set up transforms.
+        if ( !read_started() )
+            setup_transformations( view_data.format_ );
+
+        read_rows( view_data );
+    }
+
+    void raw_copy_to_prepared_view( detail::libpng_view_data_t const & view_data ) const
+    {
+        // Implementation note:
+        //   The builtin-conversion path of the generic backend also lands here
+        // with the closest_gil_supported_format() (which differs from the
+        // native format for palette and sub-byte gray images) so the required
+        // expansions are set up the same way as for raw conversions.
+        raw_convert_to_prepared_view( view_data );
+    }
 
-        unsigned int const bit_depth  ( ( view_data.format_ >> 16 ) & 0xFF );
-        unsigned int const colour_type(   view_data.format_         & 0xFF );
+    unsigned int cached_format_size( format_t const format ) const
+    {
+        return number_of_channels() * format_bit_depth( format ) / 8;
+    }
 
-        if ( colour_type == PNG_COLOR_TYPE_PALETTE )
+    void setup_transformations( format_t const target_format ) const
+    {
+        format_t     const source_format     ( format()                            );
+        unsigned int const source_bit_depth  ( format_bit_depth  ( source_format ) );
+        unsigned int const source_colour_type( format_colour_type( source_format ) );
+        unsigned int const target_bit_depth  ( format_bit_depth  ( target_format ) );
+        unsigned int const target_colour_type( format_colour_type( target_format ) );
+        bool         const has_tRNS          ( ::png_get_valid( &png_object(), &info_object(), PNG_INFO_tRNS ) != 0 );
+
+        if ( target_bit_depth < 8 )
         {
-            ::png_set_palette_to_rgb( &png_object() );
+            // Packed (sub-byte) gray targets are filled with the native rows
+            // (LibPNG cannot reduce the bit depth).
+            io::detail::io_error_if( source_format != target_format, "Unsupported PNG format conversion." );
         }
         else
-        if ( ( colour_type == PNG_COLOR_TYPE_GRAY ) && ( bit_depth < 8 ) )
         {
-            ::png_set_expand_gray_1_2_4_to_8( &png_object() );
+            if ( source_colour_type == PNG_COLOR_TYPE_PALETTE )
+                ::png_set_palette_to_rgb( &png_object() );
+            else
+            if ( source_bit_depth < 8 )
+                ::png_set_expand_gray_1_2_4_to_8( &png_object() );
+
+            bool const source_has_alpha( ( source_colour_type & PNG_COLOR_MASK_ALPHA ) || has_tRNS );
+            bool const target_has_alpha( ( target_colour_type & PNG_COLOR_MASK_ALPHA ) != 0        );
+            if ( target_has_alpha )
+            {
+                if ( has_tRNS )
+                    ::png_set_tRNS_to_alpha( &png_object() );
+                else
+                if ( !source_has_alpha )
+                    ::png_set_add_alpha( &png_object(), 0xFFFF, PNG_FILLER_AFTER );
+            }
+            else
+            if ( source_has_alpha ) // (palette expansion also expands tRNS)
+                ::png_set_strip_alpha( &png_object() );
+
+            bool const source_is_colour( ( source_colour_type & PNG_COLOR_MASK_COLOR ) != 0 );
+            bool const target_is_colour( ( target_colour_type & PNG_COLOR_MASK_COLOR ) != 0 );
+            if ( !source_is_colour &&  target_is_colour )
+                ::png_set_gray_to_rgb( &png_object() );
+            if (  source_is_colour && !target_is_colour )
+                ::png_set_rgb_to_gray_fixed( &png_object(), 1, -1, -1 );
+
+            if ( ( source_bit_depth == 16 ) && ( target_bit_depth == 8 ) )
+                ::png_set_strip_16( &png_object() );
+            if ( ( source_bit_depth != 16 ) && ( target_bit_depth == 16 ) )
+            {
+            #ifdef PNG_READ_EXPAND_16_SUPPORTED
+                ::png_set_expand_16( &png_object() );
+            #else
+                io::detail::io_error( "Unsupported PNG format conversion." );
+            #endif // PNG_READ_EXPAND_16_SUPPORTED
+            }
         }
 
-        if ( !( colour_type & PNG_COLOR_MASK_ALPHA ) )
-            ::png_set_strip_alpha( &png_object() );
-
-        if ( ::png_get_valid( &png_object(), &info_object(), PNG_INFO_tRNS ) )
-            ::png_set_tRNS_to_alpha( &png_object() );
-
-        if ( bit_depth == 8 )
-            ::png_set_strip_16( &png_object() );
-
-        //...zzz...
-
-        //if (color_type == PNG_COLOR_TYPE_RGB ||
-        //    color_type == PNG_COLOR_TYPE_RGB_ALPHA)
-        //    png_set_bgr(png_ptr);
-
-        //if (color_type == PNG_COLOR_TYPE_RGB ||
-        //    color_type == PNG_COLOR_TYPE_GRAY)
-        //    png_set_add_alpha(png_ptr, filler, PNG_FILLER_AFTER);
-
-        //if (color_type == PNG_COLOR_TYPE_RGB_ALPHA)
-        //    png_set_swap_alpha(png_ptr);
-
-        //if (color_type == PNG_COLOR_TYPE_GRAY ||
-        //    color_type == PNG_COLOR_TYPE_GRAY_ALPHA)
-        //    png_set_gray_to_rgb(png_ptr);
-
-        //if (color_type == PNG_COLOR_TYPE_RGB ||
-        //    color_type == PNG_COLOR_TYPE_RGB_ALPHA)
-        //    png_set_rgb_to_gray_fixed(png_ptr, error_action,
-        //    int red_weight, int green_weight);
-
-        ::png_read_update_info( &png_object(), &info_object() );
-
-        raw_copy_to_prepared_view( view_data );
+        update_info();
+        BOOST_ASSERT
+        (
+            ::png_get_rowbytes( &png_object(), &info_object() ) ==
+            ( dimensions().x * ::png_get_channels( &png_object(), &info_object() ) * target_bit_depth + 7 ) / 8
+        );
     }
 
-    void raw_copy_to_prepared_view( detail::libpng_view_data_t const view_data ) const BOOST_GIL_CAN_THROW //...zzz...a plain throw(...) would be enough here but it chokes GCC...
+    void read_rows( detail::libpng_view_data_t const & view_data ) const BOOST_GIL_CAN_THROW //...zzz...a plain throw(...) would be enough here but it chokes GCC...
     {
         #ifndef BOOST_GIL_THROW_THROUGH_C_SUPPORTED
             if ( setjmp( error_handler_target() ) )
                 detail::throw_libpng_error();
         #endif // BOOST_GIL_THROW_THROUGH_C_SUPPORTED
 
-        unsigned int number_of_passes( ::png_set_interlace_handling( &png_object() ) );
-        BF_ASSUME( ( number_of_passes == 1 ) || ( number_of_passes == 7 ) );
+        if ( number_of_passes() != 1 )
+        {
+            read_interlaced_rows( view_data.buffer_, view_data.stride_, view_data.offset_, view_data.height_ );
+            return;
+        }
 
         skip_rows( view_data.offset_ );
 
-        while ( number_of_passes-- )
+        png_byte       *       p_row( view_data.buffer_                                 );
+        png_byte const * const p_end( p_row + ( view_data.height_ * view_data.stride_ ) );
+        while ( p_row < p_end )
+        {
+            read_row( p_row );
+            memunit_advance( p_row, view_data.stride_ );
+        }
+    }
+
+    // Implementation note:
+    //   Every Adam7 pass spans the whole image so all but the last pass have to
+    // be decoded to the end, rows outside the ROI being passed as NULL so that
+    // libpng merely decodes and discards them. Once the last pass stops at the
+    // end of the ROI the earlier passes are gone (there is no 'rewind'
+    // capability for LibPNG) so an interlaced image can only be read with a
+    // single (ROI) read - further (e.g. band by band) reads are reported as
+    // errors instead of returning garbage.
+    void read_interlaced_rows( png_byte * const p_rows, std::size_t const stride, unsigned int const first_row, unsigned int const number_of_rows ) const
+    {
+        io::detail::io_error_if( read_started(), "Interlaced (Adam7) PNG images can only be read in one go." );
+
+        unsigned int const number_of_passes( this->number_of_passes() );
+        unsigned int const image_height    ( dimensions().y           );
+        for ( unsigned int pass( 0 ); pass < number_of_passes; ++pass )
         {
-            png_byte       *       p_row( view_data.buffer_                                 );
-            png_byte const * const p_end( p_row + ( view_data.height_ * view_data.stride_ ) );
-            while ( p_row < p_end )
+            unsigned int const pass_rows( ( pass == number_of_passes - 1 ) ? first_row + number_of_rows : image_height );
+            for ( unsigned int row( 0 ); row < pass_rows; ++row )
             {
-                read_row( p_row );
-                memunit_advance( p_row, view_data.stride_ );
+                unsigned int const target_row( row - first_row );
+                read_row( ( target_row < number_of_rows ) ? p_rows + target_row * stride : NULL );
             }
         }
     }
 
-    unsigned int cached_format_size( format_t const format ) const
+    // Implementation note:
+    //   LibPNG computes the per pass row counts in png_read_update_info()
+    // (png_read_start_row()) so interlace handling has to be requested before
+    // it (with all the other transformations).
+    void update_info() const
     {
-        return number_of_channels() * format_bit_depth( format ) / 8;
+        BOOST_VERIFY( static_cast<unsigned int>( ::png_set_interlace_handling( &png_object() ) ) == number_of_passes() );
+        ::png_read_update_info( &png_object(), &info_object() );
     }
 
-private:
+    unsigned int number_of_passes() const
+    {
+        return ( ::png_get_interlace_type( &png_object(), &info_object() ) == PNG_INTERLACE_ADAM7 ) ? 7 : 1;
+    }
+
+    bool read_started() const { return ( png_object().row_number != 0 ) || ( png_object().pass != 0 ); }
+
     void cleanup_and_throw_libpng_error()
     {
         destroy_read_struct();
@@ -27,6 +27,7 @@
 #include "boost/scoped_array.hpp"
 
 #include "png.h"
+#include "zlib.h"
 
 #ifndef BOOST_GIL_THROW_THROUGH_C_SUPPORTED
     #include <csetjmp>
@@ -40,6 +41,69 @@ namespace gil
 {
 //------------------------------------------------------------------------------
 
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \class png_writer_options
+///
+/// \brief Compression settings used by libpng_writer::write_default() (and
+/// the streamed output).
+///
+/// Negative/zero/default values leave the choice to LibPNG (and zlib).
+///
+////////////////////////////////////////////////////////////////////////////////
+
+struct png_writer_options
+{
+    enum strategy_t
+    {
+        default_strategy = -1                , ///< Z_FILTERED for filtered rows, Z_DEFAULT_STRATEGY otherwise
+        plain            = Z_DEFAULT_STRATEGY,
+        filtered         = Z_FILTERED        ,
+        huffman_only     = Z_HUFFMAN_ONLY    ,
+        rle              = Z_RLE
+    };
+
+    /// Row filters that LibPNG may choose from (for each row), may be combined.
+    enum filter_t
+    {
+        default_filters = 0               , ///< LibPNG's choice (none for palette and sub-byte images, all otherwise)
+        filter_none     = PNG_FILTER_NONE ,
+        filter_sub      = PNG_FILTER_SUB  ,
+        filter_up       = PNG_FILTER_UP   ,
+        filter_avg      = PNG_FILTER_AVG  ,
+        filter_paeth    = PNG_FILTER_PAETH,
+        all_filters     = PNG_ALL_FILTERS
+    };
+
+    png_writer_options()
+        :
+        compression_level( -1               ),
+        strategy         ( default_strategy ),
+        memory_level     ( 0                ),
+        window_bits      ( 0                ),
+        filters          ( default_filters  )
+    {}
+
+    /// A preset for transient images where encoding speed matters more than
+    /// size: the cheap SUB filter on every row (no per row filter selection
+    /// heuristic) with the fastest zlib level. Palette and sub-byte images,
+    /// which do not benefit from filtering, are left unfiltered.
+    static png_writer_options fast()
+    {
+        png_writer_options options;
+        options.compression_level = 1;
+        options.filters           = filter_sub;
+        return options;
+    }
+
+    int          compression_level; ///< [0, 9] (Z_DEFAULT_COMPRESSION (6) by default)
+    strategy_t   strategy         ;
+    int          memory_level     ; ///< [1, 9] (8 by default)
+    int          window_bits      ; ///< [8, 15] (15 by default)
+    unsigned int filters          ; ///< a combination of filter_t flags
+}; // struct png_writer_options
+
+
 ////////////////////////////////////////////////////////////////////////////////
 ///
 /// \class libpng_writer
@@ -54,18 +118,8 @@ class libpng_writer
 public:
     void write_default( libpng_view_data_t const & view )
     {
-        ::png_set_IHDR
-        (
-            &png_object ()                    ,
-            &info_object()                    ,
-            view.width_                       ,
-            view.height_                      ,
-            format_bit_depth  ( view.format_ ),
-            format_colour_type( view.format_ ),
-            PNG_INTERLACE_NONE                ,
-            PNG_COMPRESSION_TYPE_DEFAULT      ,
-            PNG_FILTER_TYPE_DEFAULT
-        );
+        set_header( view.width_, view.height_, view.format_ );
+        apply_options();
 
         //::png_set_invert_alpha( &png_object() );
 
@@ -81,22 +135,59 @@ public:
                 detail::throw_libpng_error();
         #endif // BOOST_GIL_THROW_THROUGH_C_SUPPORTED
 
-        if ( little_endian() )
-            ::png_set_swap( &png_object() );
+        write_info();
+        write_rows( view.buffer_, view.height_, view.stride_ );
+        ::png_write_end( &png_object(), 0 );
+    }
 
-        ::png_write_info( &png_object(), &info_object() );
-        
-        png_byte *       p_row( view.buffer_ );
-        png_byte * const p_end( memunit_advanced( view.buffer_, view.height_ * view.stride_ ) );
-        while ( p_row < p_end )
-        {
-            ::png_write_row( &png_object(), p_row );
-            memunit_advance( p_row, view.stride_ );
-        }
+public: /// \ingroup Streaming (band by band) output
+    /// Writes the header (and the other info chunks) for an image of the given
+    /// dimensions and format. The rows are then passed with write_rows().
+    void begin( dimensions_t const & dimensions, format_t const format ) BOOST_GIL_CAN_THROW
+    {
+        set_header( dimensions.x, dimensions.y, format );
+        apply_options();
+
+        #ifndef BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+		if ( setjmp( error_handler_target() ) )
+                detail::throw_libpng_error();
+        #endif // BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+
+        write_info();
+    }
+
+    /// Compresses the next band of rows (of the full image width).
+    void write_rows( libpng_view_data_t const & band ) BOOST_GIL_CAN_THROW
+    {
+        BOOST_ASSERT( band.width_  == ::png_get_image_width( &png_object(), &info_object() ) );
+        BOOST_ASSERT( band.format_ == format()                                                );
+        BOOST_ASSERT( png_object().row_number + band.height_ <= ::png_get_image_height( &png_object(), &info_object() ) );
+
+        #ifndef BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+		if ( setjmp( error_handler_target() ) )
+                detail::throw_libpng_error();
+        #endif // BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+
+        write_rows( band.buffer_, band.height_, band.stride_ );
+    }
+
+    /// Flushes the remaining data and writes the end of the image.
+    void finish() BOOST_GIL_CAN_THROW
+    {
+        io::detail::io_error_if( png_object().row_number != ::png_get_image_height( &png_object(), &info_object() ), "Not all rows of the streamed PNG image were written." );
+
+        #ifndef BOOST_GIL_THROW_THROUGH_C_SUPPORTED
+		if ( setjmp( error_handler_target() ) )
+                detail::throw_libpng_error();
+        #endif // BOOST_GIL_THROW_THROUGH_C_SUPPORTED
 
         ::png_write_end( &png_object(), 0 );
     }
 
+    /// Compression settings used by write_default() and begin().
+    void                       set_options( png_writer_options const & options ) { options_ = options; }
+    png_writer_options const &     options(                                    ) const { return options_; }
+
 protected:
     libpng_writer( void * const p_target_object, png_rw_ptr const write_data_fn, png_flush_ptr const output_flush_fn )
         :
@@ -114,6 +205,68 @@ protected:
     }
 
 private:
+    void set_header( unsigned int const width, unsigned int const height, format_t const format )
+    {
+        ::png_set_IHDR
+        (
+            &png_object ()              ,
+            &info_object()              ,
+            width                       ,
+            height                      ,
+            format_bit_depth  ( format ),
+            format_colour_type( format ),
+            PNG_INTERLACE_NONE          ,
+            PNG_COMPRESSION_TYPE_DEFAULT,
+            PNG_FILTER_TYPE_DEFAULT
+        );
+    }
+
+    // Implementation note:
+    //   Older LibPNG versions initialise zlib already in png_write_info()
+    // (png_write_IHDR()) so the options have to be applied before it.
+    void apply_options()
+    {
+        png_struct & png( png_object() );
+
+        if ( options_.compression_level >= 0 )
+            ::png_set_compression_level( &png, options_.compression_level );
+        if ( options_.strategy != png_writer_options::default_strategy )
+            ::png_set_compression_strategy( &png, options_.strategy );
+        if ( options_.memory_level )
+            ::png_set_compression_mem_level( &png, options_.memory_level );
+        if ( options_.window_bits )
+            ::png_set_compression_window_bits( &png, options_.window_bits );
+
+        if ( options_.filters != png_writer_options::default_filters )
+        {
+            // Filtering palette and sub-byte images only costs time.
+            bool const unfilterable
+            (
+                ( format_colour_type( format() ) == PNG_COLOR_TYPE_PALETTE ) ||
+                ( format_bit_depth  ( format() ) <  8                      )
+            );
+            ::png_set_filter( &png, PNG_FILTER_TYPE_BASE, unfilterable ? PNG_FILTER_NONE : options_.filters );
+        }
+    }
+
+    void write_info() BOOST_GIL_CAN_THROW
+    {
+        if ( little_endian() )
+            ::png_set_swap( &png_object() );
+
+        ::png_write_info( &png_object(), &info_object() );
+    }
+
+    void write_rows( png_byte * p_row, unsigned int const number_of_rows, unsigned int const stride ) BOOST_GIL_CAN_THROW
+    {
+        png_byte * const p_end( memunit_advanced( p_row, number_of_rows * stride ) );
+        while ( p_row < p_end )
+        {
+            ::png_write_row( &png_object(), p_row );
+            memunit_advance( p_row, stride );
+        }
+    }
+
     void destroy_write_struct() { ::png_destroy_write_struct( &png_object_for_destruction(), &info_object_for_destruction() ); }
 
     void cleanup_and_throw_libpng_error()
@@ -126,6 +279,9 @@ private:
     {
         ::png_set_write_fn( &png_object(), p_target_object, write_data_fn, output_flush_fn );
     }
+
+private:
+    png_writer_options options_;
 }; // class libpng_writer
 
 
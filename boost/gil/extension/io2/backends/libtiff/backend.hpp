@@ -36,10 +36,15 @@
 #endif
 
 #include <boost/array.hpp>
+#include <boost/cstdint.hpp>
 #include <boost/mpl/set/set10.hpp>
 #include <boost/mpl/vector.hpp>
 #include <boost/smart_ptr/scoped_array.hpp>
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
 extern "C"
 {
     #include "tiff.h"
@@ -170,10 +175,17 @@ typedef mpl::vector35
 > libtiff_supported_pixel_formats;
 
 
+// Implementation note:
+//   toff_t is a 64 bit type (since LibTIFF 4.0) so the _long device functions
+// are used, otherwise files (BigTIFF or not) larger than 2/4 GB get
+// truncated offsets. The device seek functions do not return the resulting
+// position (that LibTIFF expects) so it is queried separately.
 template <typename Handle>
 toff_t seek( thandle_t const handle, toff_t const off, int const whence )
 {
-    return static_cast<tsize_t>( device<Handle>::seek( static_cast<device_base::seek_origin>( whence ), off, reinterpret_cast<Handle>( handle ) ) );
+    Handle const device_handle( reinterpret_cast<Handle>( handle ) );
+    device<Handle>::seek_long( static_cast<device_base::seek_origin>( whence ), static_cast<intmax_t>( off ), device_handle );
+    return static_cast<toff_t>( device<Handle>::position_long( device_handle ) );
 }
 
 template <typename Handle>
@@ -191,14 +203,48 @@ inline int nop_close( thandle_t /*handle*/ )
 template <typename Handle>
 toff_t size( thandle_t const handle )
 {
-    return static_cast<toff_t>( device<Handle>::size( reinterpret_cast<Handle>( handle ) ) );
+    return static_cast<toff_t>( device<Handle>::size_long( reinterpret_cast<Handle>( handle ) ) );
 }
 
 
-inline tsize_t memory_read_proc( thandle_t /*handle*/, tdata_t /*buf*/, tsize_t /*size*/ )
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \class tiff_memory_source_t
+/// \internal
+/// \brief Client data (thandle_t) for reading TIFFs from a memory range.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+struct tiff_memory_source_t
 {
-    BF_UNREACHABLE_CODE
-    return 0;
+    tiff_memory_source_t() : p_begin( 0 ), size( 0 ), position( 0 ) {}
+
+    explicit tiff_memory_source_t( memory_range_t const & memory_range )
+        :
+        p_begin ( memory_range.begin() ),
+        size    ( memory_range.size () ),
+        position( 0                    )
+    {}
+
+    memory_range_t::value_type const * p_begin ;
+    toff_t                             size    ;
+    toff_t                             position;
+}; // struct tiff_memory_source_t
+
+inline tiff_memory_source_t & memory_source( thandle_t const handle )
+{
+    BOOST_ASSERT( handle );
+    return *static_cast<tiff_memory_source_t *>( handle );
+}
+
+inline tsize_t memory_read_proc( thandle_t const handle, tdata_t const buf, tsize_t const size )
+{
+    tiff_memory_source_t & source( memory_source( handle ) );
+    BOOST_ASSERT( source.position <= source.size );
+    tsize_t const bytes_to_read( static_cast<tsize_t>( std::min<toff_t>( size, source.size - source.position ) ) );
+    std::memcpy( buf, source.p_begin + source.position, bytes_to_read );
+    source.position += bytes_to_read;
+    return bytes_to_read;
 }
 
 inline tsize_t memory_write_proc( thandle_t /*handle*/, tdata_t /*buf*/, tsize_t /*size*/ )
@@ -207,10 +253,22 @@ inline tsize_t memory_write_proc( thandle_t /*handle*/, tdata_t /*buf*/, tsize_t
     return 0;
 }
 
-inline toff_t memory_seek_proc( thandle_t /*handle*/, toff_t /*off*/, int /*whence*/ )
+inline toff_t memory_seek_proc( thandle_t const handle, toff_t const off, int const whence )
 {
-    BF_UNREACHABLE_CODE
-    return 0;
+    tiff_memory_source_t & source( memory_source( handle ) );
+    toff_t new_position;
+    switch ( whence )
+    {
+        case SEEK_SET: new_position =                   off; break;
+        case SEEK_CUR: new_position = source.position + off; break;
+        case SEEK_END: new_position = source.size     + off; break;
+        default: BF_UNREACHABLE_CODE new_position = 0;
+    }
+    // Seeking past the end of a read-only source is an error (unsigned
+    // wrap-around from 'negative' offsets included).
+    if ( new_position > source.size )
+        return static_cast<toff_t>( -1 );
+    return source.position = new_position;
 }
 
 inline int memory_close_proc( thandle_t /*handle*/ )
@@ -218,21 +276,27 @@ inline int memory_close_proc( thandle_t /*handle*/ )
     return 0;
 }
 
-inline toff_t memory_size_proc( thandle_t /*handle*/ )
+inline toff_t memory_size_proc( thandle_t const handle )
 {
-    BF_UNREACHABLE_CODE
-    return 0;
+    return memory_source( handle ).size;
 }
 
+// Implementation note:
+//   Handing libtiff the source buffer as a 'mapped file' lets it decode (and,
+// for uncompressed data, copy) directly from it instead of reading
+// strips/tiles into its own temporary buffers.
 inline int memory_map_proc( thandle_t const handle, tdata_t * const pbase, toff_t * const psize )
 {
-    BOOST_ASSERT( handle );
-    BOOST_ASSERT( pbase  );
-    BOOST_ASSERT( psize  );
-	//...zzz...
-    //*pbase = static_cast<tdata_t>( const_cast<memory_range_t::value_type *>( gil_reinterpret_cast<memory_range_t *>( handle )->begin() ) );
-    //*psize = gil_reinterpret_cast<memory_range_t *>( handle )->size ();
-    return false;
+    BOOST_ASSERT( pbase );
+    BOOST_ASSERT( psize );
+    tiff_memory_source_t const & source( memory_source( handle ) );
+    *pbase = static_cast<tdata_t>( const_cast<memory_range_t::value_type *>( source.p_begin ) );
+    *psize = source.size;
+    return true;
+}
+
+inline void memory_unmap_proc( thandle_t /*handle*/, tdata_t /*base*/, toff_t /*size*/ )
+{
 }
 
 
@@ -321,9 +385,10 @@ struct backend_traits<libtiff_image>
     template <typename Pixel, bool IsPlanar>
     struct is_supported : mpl::true_ {}; //...zzz...
 
-    typedef mpl::set1
+    typedef mpl::set2
     <
-        char const *
+        char const *,
+        memory_range_t
     > native_sources;
 
     typedef mpl::set1
@@ -371,39 +436,86 @@ protected:
         construction_check();
     }
 
+    libtiff_image( detail::tiff_memory_source_t & memory_source, char const * const access_mode )
+        :
+        p_tiff_
+        (
+            ::TIFFClientOpen
+            (
+                "", access_mode,
+                    &memory_source,
+                    &detail::memory_read_proc,
+                    &detail::memory_write_proc,
+                    &detail::memory_seek_proc,
+                    &detail::memory_close_proc,
+                    &detail::memory_size_proc,
+                    &detail::memory_map_proc,
+                    &detail::memory_unmap_proc
+            )
+        )
+    {
+        construction_check();
+    }
+
     template <typename DeviceHandle>
     libtiff_image
     (
-        DeviceHandle const handle,
+        DeviceHandle      const handle,
         TIFFReadWriteProc const read_proc,
         TIFFReadWriteProc const write_proc,
         TIFFMapFileProc   const map_proc,
-        TIFFUnmapFileProc const unmap_proc
+        TIFFUnmapFileProc const unmap_proc,
+        char const *      const access_mode
     )
         :
-        p_tiff_
-        (
-            ::TIFFClientOpen
-            (
-                "", "", //"M"
-                    reinterpret_cast<thandle_t>( handle ),
-                    read_proc,
-                    write_proc,
-                    &detail::seek<DeviceHandle>,
-                    device<DeviceHandle>::auto_closes ? &detail::nop_close : &detail::close<<DeviceHandle>
-                    &detail::size<<DeviceHandle>,
-                    map_proc,
-                    unmap_proc
-            )
-        )
+        p_tiff_( open_device( handle, read_proc, write_proc, map_proc, unmap_proc, access_mode ) )
     {
-        BOOST_STATIC_ASSERT( sizeof( handle ) <= sizeof( thandle_t ) );
         construction_check();
     }
 
+    /// Deferred construction: for writers that can only choose the access mode
+    /// (e.g. classic TIFF vs BigTIFF) once they know what they will write.
+    libtiff_image() : p_tiff_( 0 ) {}
+
+    bool created() const { return p_tiff_ != 0; }
+
+    void attach( TIFF * const p_tiff )
+    {
+        BOOST_ASSERT_MSG( !p_tiff_, "LibTIFF object already created." );
+        p_tiff_ = p_tiff;
+        construction_check();
+    }
+
+    template <typename DeviceHandle>
+    static TIFF * open_device
+    (
+        DeviceHandle      const handle,
+        TIFFReadWriteProc const read_proc,
+        TIFFReadWriteProc const write_proc,
+        TIFFMapFileProc   const map_proc,
+        TIFFUnmapFileProc const unmap_proc,
+        char const *      const access_mode
+    )
+    {
+        BOOST_STATIC_ASSERT( sizeof( handle ) <= sizeof( thandle_t ) );
+        return ::TIFFClientOpen
+        (
+            "", access_mode,
+                reinterpret_cast<thandle_t>( handle ),
+                read_proc,
+                write_proc,
+                &detail::seek<DeviceHandle>,
+                device<DeviceHandle>::auto_closes ? &detail::nop_close : &detail::close<DeviceHandle>,
+                &detail::size<DeviceHandle>,
+                map_proc,
+                unmap_proc
+        );
+    }
+
     BF_NOTHROW ~libtiff_image()
     {
-        ::TIFFClose( &lib_object() );
+        if ( p_tiff_ )
+            ::TIFFClose( p_tiff_ );
     }
 
 private:
@@ -471,7 +583,7 @@ private:
     }
 
 private:
-    TIFF * const p_tiff_;
+    TIFF * p_tiff_;
 }; // class libtiff_image
 
 #if defined( BOOST_MSVC )
@@ -25,14 +25,21 @@
 
 #include "boost/gil/extension/io2/detail/io_error.hpp"
 #include "boost/gil/extension/io2/detail/libx_shared.hpp"
+#include "boost/gil/extension/io2/detail/parallel.hpp"
 #include "boost/gil/extension/io2/detail/platform_specifics.hpp"
+#include "boost/gil/extension/io2/detail/scratch_arena.hpp"
 #include "boost/gil/extension/io2/detail/shared.hpp"
+#include "boost/gil/extension/io2/tile_cache.hpp"
 
 #include "boost/gil/image_view_factory.hpp"
 
 #include <boost/array.hpp>
 #include <boost/mpl/vector.hpp>
-#include <boost/smart_ptr/scoped_array.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
 
 extern "C"
 {
@@ -77,21 +84,46 @@ void unmap( thandle_t /*handle*/, tdata_t /*base*/, toff_t /*size*/ )
 
 class libtiff_image::native_reader
     :
-    public libtiff_image,
-    public detail::backend_reader<libtiff_image>
+    // Base-from-member: the memory source must outlive the TIFF object.
+    private detail::tiff_memory_source_t,
+    public  libtiff_image,
+    public  detail::backend_reader<libtiff_image>
 {
+public:
+    // Both bases define a dimensions_t.
+    typedef libtiff_image::dimensions_t dimensions_t;
+
 public: /// \ingroup Construction
     explicit native_reader( char const * const file_name )
         :
         libtiff_image( file_name, "r" ),
-        format_      ( get_format()   )
+        file_name_   ( file_name      ),
+        format_      ( get_format()   ),
+        current_page_( 0              ),
+        p_tile_cache_( 0              ),
+        source_id_   ( 0              )
+    {}
+
+    /// Reads directly from (without copying) the memory range which has to
+    /// outlive the reader.
+    explicit native_reader( memory_range_t const & memory_range )
+        :
+        detail::tiff_memory_source_t( memory_range                                          ),
+        libtiff_image               ( static_cast<detail::tiff_memory_source_t &>( *this ), "rM" ),
+        format_                     ( get_format()                                          ),
+        current_page_               ( 0                                                     ),
+        p_tile_cache_               ( 0                                                     ),
+        source_id_                  ( 0                                                     )
     {}
 
     template <typename DeviceHandle>
     explicit native_reader( DeviceHandle const handle )
         :
-        libtiff_image( handle, &input_device<DeviceHandle>::read, NULL, NULL, NULL ),
-        format_      ( get_format()                                                )
+        libtiff_image( handle, &detail::read<DeviceHandle>, NULL, &detail::map<DeviceHandle>, &detail::unmap<DeviceHandle>, "r" ),
+        format_      ( get_format()                                                                                         ),
+        current_page_( 0                                                                                                    ),
+        p_tile_cache_( 0                                                                                                    ),
+        source_id_   ( 0                                                                                                    )
     {}
 
 public:
@@ -115,6 +147,231 @@ public: // Low-level (row, strip, tile) access
         );
     }
 
+public: /// \ingroup Multi-page (multi-directory) access
+    struct page_t
+    {
+        toff_t       ifd_offset;
+        dimensions_t dimensions;
+    };
+
+    typedef std::vector<page_t> page_table_t;
+
+    /// The IFD chain is walked only once (on first use) and the directory
+    /// offsets are cached so that set_page() can seek directly to any page.
+    page_table_t const & pages() const
+    {
+        if ( pages_.empty() )
+        {
+            toff_t const current_directory( ::TIFFCurrentDirOffset( &lib_object() ) );
+            detail::io_error_if_not( ::TIFFSetDirectory( &lib_object(), 0 ), "Failed to read a TIFF directory." );
+            do
+            {
+                page_t const page = { ::TIFFCurrentDirOffset( &lib_object() ), dimensions() };
+                pages_.push_back( page );
+            } while ( ::TIFFReadDirectory( &lib_object() ) );
+            detail::io_error_if_not( ::TIFFSetSubDirectory( &lib_object(), current_directory ), "Failed to read a TIFF directory." );
+        }
+        return pages_;
+    }
+
+    unsigned int number_of_pages(                         ) const { return static_cast<unsigned int>( pages().size() ); }
+    dimensions_t page_dimensions( unsigned int const page ) const { return pages()[ page ].dimensions; }
+    unsigned int current_page   (                         ) const { return current_page_; }
+
+    /// Makes the specified page (directory) the source for all subsequent
+    /// reads (also updating format() and dimensions()).
+    void set_page( unsigned int const page )
+    {
+        page_table_t const & table( pages() );
+        detail::io_error_if( page >= table.size(), "TIFF page index out of range." );
+        detail::io_error_if_not( ::TIFFSetSubDirectory( &lib_object(), table[ page ].ifd_offset ), "Failed to read a TIFF directory." );
+        format_       = get_format();
+        current_page_ = page;
+    }
+
+    /// Shares the page table of another reader (of the same source) to avoid
+    /// walking the IFD chain again.
+    void adopt_pages( page_table_t const & pages ) { pages_ = pages; }
+
+    /// Invokes functor( native_reader &, page ) for every page of source (a
+    /// file name or a memory range), in parallel, with every worker thread
+    /// reading through its own native_reader (i.e. its own TIFF handle).
+    template <typename Source, typename Functor>
+    static void for_each_page( Source const & source, Functor & functor, unsigned int const number_of_threads = 0 )
+    {
+        page_table_t const pages( native_reader( source ).pages() );
+        unsigned int const threads( number_of_threads ? number_of_threads : detail::hardware_concurrency() );
+        page_worker_t<Source, Functor> worker( source, functor, pages, threads );
+        detail::parallel_for( static_cast<unsigned int>( pages.size() ), threads, worker );
+        worker.throw_if_failed();
+    }
+
+public: /// \ingroup Zero-copy access
+    /// Uncompressed, byte aligned, native endian data read from a memory range
+    /// (e.g. a memory mapped file) can be accessed in place, through views
+    /// that alias the source bytes of individual tiles or strips.
+    bool can_do_direct_access() const
+    {
+        return
+            ( static_cast<detail::tiff_memory_source_t const &>( *this ).p_begin != 0              ) &&
+            ( get_field<uint16>( TIFFTAG_COMPRESSION ) == COMPRESSION_NONE                        ) &&
+            ( get_field<uint16>( TIFFTAG_FILLORDER   ) == FILLORDER_MSB2LSB                       ) &&
+            ( format_bits().bits_per_sample % 8 == 0                                              ) &&
+            ( ( format_bits().bits_per_sample == 8 ) || !::TIFFIsByteSwapped( &lib_object() )     );
+    }
+
+    /// Returns a (non-mutable) view of the part of the specified tile that
+    /// lies within the image. The data is not necessarily aligned for the
+    /// View's channel type. PLANARCONFIG_SEPARATE data is accessed one plane
+    /// (sample) at a time so View then has to be a single channel view.
+    template <class View>
+    View direct_tile_view( point2<uint32> const & tile_position, tsample_t const plane = 0 ) const
+    {
+        detail::io_error_if_not( can_do_tile_access(), "TIFF image is not tiled." );
+        point2<uint32> const tile_dimensions( this->tile_dimensions() );
+        point2<uint32> const image_dimensions( dimensions() );
+        detail::io_error_if
+        (
+            ( tile_position.x >= round_up_divide( image_dimensions.x, tile_dimensions.x ) ) ||
+            ( tile_position.y >= round_up_divide( image_dimensions.y, tile_dimensions.y ) ),
+            "TIFF tile position out of range."
+        );
+        detail::io_error_if( plane >= number_of_planes(), "TIFF plane out of range." );
+        uint32 const x( tile_position.x * tile_dimensions.x );
+        uint32 const y( tile_position.y * tile_dimensions.y );
+        std::size_t const row_size( ::TIFFTileRowSize( &lib_object() ) );
+        uint32      const rows    ( std::min( tile_dimensions.y, image_dimensions.y - y ) );
+        return direct_view<View>
+        (
+            ::TIFFComputeTile( &lib_object(), x, y, 0, plane ),
+            std::min( tile_dimensions.x, image_dimensions.x - x ),
+            rows,
+            row_size
+        );
+    }
+
+    template <class View>
+    View direct_strip_view( tstrip_t const strip, tsample_t const plane = 0 ) const
+    {
+        detail::io_error_if_not( can_do_row_access(), "TIFF image is not stripped." );
+        point2<uint32> const image_dimensions( dimensions() );
+        uint32 const rows_per_strip( std::min( get_field<uint32>( TIFFTAG_ROWSPERSTRIP ), image_dimensions.y ) );
+        detail::io_error_if( strip >= round_up_divide( image_dimensions.y, rows_per_strip ), "TIFF strip number out of range." );
+        detail::io_error_if( plane >= number_of_planes(), "TIFF plane out of range." );
+        uint32 const first_row     ( strip * rows_per_strip );
+        return direct_view<View>
+        (
+            ::TIFFComputeStrip( &lib_object(), first_row, plane ),
+            image_dimensions.x,
+            std::min( rows_per_strip, image_dimensions.y - first_row ),
+            ::TIFFScanlineSize( &lib_object() )
+        );
+    }
+
+private:
+    template <class View>
+    View direct_view( uint32 const strile, uint32 const width, uint32 const height, std::size_t const row_size ) const
+    {
+        BOOST_STATIC_ASSERT( !view_is_mutable<View>::value );
+        detail::io_error_if_not( can_do_direct_access(), "TIFF data cannot be accessed in place." );
+        // A plane of PLANARCONFIG_SEPARATE data holds a single sample per
+        // pixel, contiguous data holds complete pixels.
+        bool        const separate_planes( format_bits().planar_configuration == PLANARCONFIG_SEPARATE );
+        std::size_t const sample_size    ( format_bits().bits_per_sample / 8 );
+        std::size_t const pixel_size     ( separate_planes ? sample_size : sample_size * format_bits().samples_per_pixel );
+        detail::io_error_if
+        (
+            ( sizeof( typename View::value_type ) != pixel_size ) ||
+            ( separate_planes && ( num_channels<View>::value != 1 ) ),
+            "View/TIFF pixel format mismatch."
+        );
+
+        bool const tiled( can_do_tile_access() );
+        toff_t * p_offsets    ( 0 );
+        toff_t * p_byte_counts( 0 );
+        bool const have_offsets
+        (
+            ::TIFFGetField( &lib_object(), tiled ? TIFFTAG_TILEOFFSETS    : TIFFTAG_STRIPOFFSETS   , &p_offsets     ) &&
+            ::TIFFGetField( &lib_object(), tiled ? TIFFTAG_TILEBYTECOUNTS : TIFFTAG_STRIPBYTECOUNTS, &p_byte_counts )
+        );
+        // TIFFComputeTile() and TIFFComputeStrip() do not validate their
+        // input so strile is checked before the arrays are indexed.
+        ttile_t const number_of_striles( tiled ? ::TIFFNumberOfTiles( &lib_object() ) : ::TIFFNumberOfStrips( &lib_object() ) );
+        detail::io_error_if( strile >= number_of_striles, "TIFF tile/strip out of range." );
+        detail::tiff_memory_source_t const & source( *this );
+        // The last row of an edge tile/last strip need not be padded.
+        toff_t const required_size( ( height - 1 ) * row_size + width * sizeof( typename View::value_type ) );
+        detail::io_error_if
+        (
+            !have_offsets                                           ||
+            ( p_byte_counts[ strile ] < required_size             ) ||
+            ( required_size > source.size                         ) ||
+            ( p_offsets[ strile ] > source.size - required_size   ),
+            "Corrupt or truncated TIFF data."
+        );
+        return interleaved_view
+        (
+            width,
+            height,
+            reinterpret_cast<typename View::x_iterator>( source.p_begin + p_offsets[ strile ] ),
+            row_size
+        );
+    }
+
+private:
+    template <typename Source, typename Functor>
+    class page_worker_t : boost::noncopyable
+    {
+    public:
+        page_worker_t( Source const & source, Functor & functor, page_table_t const & pages, unsigned int const number_of_workers )
+            :
+            source_ ( source                    ),
+            functor_( functor                   ),
+            pages_  ( pages                     ),
+            readers_( number_of_workers, 0      ),
+            failed_ ( number_of_workers, false  )
+        {}
+
+        ~page_worker_t()
+        {
+            for ( unsigned int worker( 0 ); worker < readers_.size(); ++worker )
+                delete readers_[ worker ];
+        }
+
+        void operator()( unsigned int const page, unsigned int const worker )
+        {
+            // Exceptions must not escape the worker threads.
+            try
+            {
+                native_reader * & p_reader( readers_[ worker ] );
+                if ( !p_reader )
+                {
+                    p_reader = new native_reader( source_ );
+                    p_reader->adopt_pages( pages_ );
+                }
+                p_reader->set_page( page );
+                functor_( *p_reader, page );
+            }
+            catch ( ... )
+            {
+                failed_[ worker ] = true;
+            }
+        }
+
+        void throw_if_failed() const
+        {
+            detail::io_error_if( std::find( failed_.begin(), failed_.end(), true ) != failed_.end(), "Failed to read a TIFF page." );
+        }
+
+    private:
+        Source               const & source_ ;
+        Functor                    & functor_;
+        page_table_t         const & pages_  ;
+        std::vector<native_reader *> readers_;
+        std::vector<unsigned char  > failed_ ;
+    }; // class page_worker_t
+
+public:
     class sequential_row_read_state
         :
         private libtiff_image::cumulative_result
@@ -157,6 +414,41 @@ public: // Low-level (row, strip, tile) access
         );
     }
 
+    /// Random access to the tile at the specified position (in tiles, not
+    /// pixels). p_tile_storage has to hold tile_size() bytes.
+    void read_tile( point2<uint32> const & tile_position, void * const p_tile_storage, tsample_t const plane = 0 ) const
+    {
+        point2<uint32> const tile_dimensions ( this->tile_dimensions() );
+        point2<uint32> const image_dimensions( dimensions()            );
+        // TIFFComputeTile() does not validate its input: an x past the last
+        // tile column would simply wrap into the next tile row.
+        detail::io_error_if
+        (
+            ( tile_position.x >= ( image_dimensions.x + tile_dimensions.x - 1 ) / tile_dimensions.x ) ||
+            ( tile_position.y >= ( image_dimensions.y + tile_dimensions.y - 1 ) / tile_dimensions.y ),
+            "TIFF tile position out of range."
+        );
+        ttile_t const tile( ::TIFFComputeTile( &lib_object(), tile_position.x * tile_dimensions.x, tile_position.y * tile_dimensions.y, 0, plane ) );
+        detail::io_error_if( tile >= ::TIFFNumberOfTiles( &lib_object() ), "TIFF tile plane out of range." );
+
+        tsize_t         const size( ::TIFFTileSize( &lib_object() ) );
+        tile_cache::tile_key_t const key = { source_id_, current_page_, tile };
+        if ( p_tile_cache_ && p_tile_cache_->find( key, p_tile_storage, size ) )
+            return;
+        detail::io_error_if( ::TIFFReadEncodedTile( &lib_object(), tile, p_tile_storage, size ) != size, "Failed to read a TIFF tile." );
+        if ( p_tile_cache_ )
+            p_tile_cache_->insert( key, p_tile_storage, size );
+    }
+
+    /// Makes read_tile( tile_position, ... ) go through a (possibly shared)
+    /// cache of decoded tiles. The source_id has to uniquely identify the
+    /// source among all readers sharing the cache. Null disables caching.
+    void set_tile_cache( tile_cache * const p_cache, uint64_t const source_id )
+    {
+        p_tile_cache_ = p_cache  ;
+        source_id_    = source_id;
+    }
+
 private:
     full_format_t get_format()
     {
@@ -214,6 +506,11 @@ private:
 private:
     detail::full_format_t::format_bitfield const & format_bits() const { return format_.bits; }
 
+    unsigned int number_of_planes() const
+    {
+        return ( format_bits().planar_configuration == PLANARCONFIG_SEPARATE ) ? format_bits().samples_per_pixel : 1;
+    }
+
     static unsigned int round_up_divide( unsigned int const dividend, unsigned int const divisor )
     {
         return ( dividend + divisor - 1 ) / divisor;
@@ -227,20 +524,50 @@ private: // Private backend_base interface.
     //                                        (13.01.2011.) (Domagoj Saric)
     friend class detail::backend<libtiff_image::native_reader>;
 
+    // Implementation note:
+    //   Everything the (per plane) decoding code needs from the current
+    // directory is read up front, on the calling thread, from the reader's own
+    // LibTIFF object: the field getters (TIFFGetFieldDefaulted()) update
+    // LibTIFF's field lookup cache and the read procedures move the source
+    // position so worker threads must only ever touch their own TIFF objects.
+    struct plane_geometry_t
+    {
+        explicit plane_geometry_t( native_reader const & source )
+            :
+            bits            ( source.format_bits()                                                   ),
+            tiled           ( source.can_do_tile_access()                                            ),
+            image_width     ( source.get_field<uint32>( TIFFTAG_IMAGEWIDTH )                         ),
+            tile_width      ( tiled ? source.get_field<uint32>( TIFFTAG_TILEWIDTH    ) : 0           ),
+            tile_height     ( tiled ? source.get_field<uint32>( TIFFTAG_TILELENGTH   ) : 0           ),
+            rows_per_strip  ( tiled ? 0 : source.get_field<uint32>( TIFFTAG_ROWSPERSTRIP )           ),
+            compression     ( source.get_field<uint16>( TIFFTAG_COMPRESSION )                        ),
+            directory_offset( ::TIFFCurrentDirOffset( &source.lib_object() )                         )
+        {}
+
+        detail::full_format_t::format_bitfield bits            ;
+        bool                                   tiled           ;
+        uint32                                 image_width     ;
+        uint32                                 tile_width      ;
+        uint32                                 tile_height     ;
+        uint32                                 rows_per_strip  ;
+        uint16                                 compression     ;
+        toff_t                                 directory_offset;
+    }; // struct plane_geometry_t
+
     struct tile_setup_t
         #ifndef __GNUC__
             : boost::noncopyable
         #endif // __GNUC__
     {
-        tile_setup_t( native_reader const & source, point2<uint32> const & dimensions, offset_t const offset, bool const nptcc )
+        tile_setup_t( TIFF & tiff, plane_geometry_t const & geometry, point2<uint32> const & dimensions, offset_t const offset, bool const nptcc )
             :
-            tile_height                ( source.get_field<uint32>( TIFFTAG_TILELENGTH ) ),
-            tile_width                 ( source.get_field<uint32>( TIFFTAG_TILEWIDTH  ) ),
-            row_tiles                  ( source.get_field<uint32>( TIFFTAG_IMAGEWIDTH ) / tile_width ),
-            size_of_pixel              ( ( source.format_bits().planar_configuration == PLANARCONFIG_CONTIG ? source.format_bits().samples_per_pixel : 1 ) * source.format_bits().bits_per_sample / 8 ),
+            tile_height                ( geometry.tile_height ),
+            tile_width                 ( geometry.tile_width  ),
+            row_tiles                  ( geometry.image_width / tile_width ),
+            size_of_pixel              ( ( geometry.bits.planar_configuration == PLANARCONFIG_CONTIG ? geometry.bits.samples_per_pixel : 1 ) * geometry.bits.bits_per_sample / 8 ),
             tile_width_bytes           ( tile_width       * size_of_pixel ),
             tile_size_bytes            ( tile_width_bytes * tile_height   ),
-            p_tile_buffer              ( new unsigned char[ tile_size_bytes * ( nptcc ? source.format_bits().samples_per_pixel : 1 ) ] ),
+            p_tile_buffer              ( tile_size_bytes * ( nptcc ? geometry.bits.samples_per_pixel : 1 ) ),
             last_row_tile_width        ( modulo_unless_zero( dimensions.x, tile_width ) /*dimensions.x % tile_width*/ ),
             tiles_per_row              ( ( dimensions.x / tile_width ) + /*( last_row_tile_width != 0 )*/ ( ( dimensions.x % tile_width ) != 0 ) ),
             last_row_tile_width_bytes  ( last_row_tile_width       * size_of_pixel ),
@@ -248,11 +575,13 @@ private: // Private backend_base interface.
             current_row_tiles_remaining( tiles_per_row                             ),
             starting_tile              ( offset / tile_height * tiles_per_row      ),
             rows_to_skip               ( offset % tile_height                      ),
-            number_of_tiles            ( round_up_divide( dimensions.y, tile_height ) * tiles_per_row * ( source.format_bits().planar_configuration == PLANARCONFIG_SEPARATE ? source.format_bits().samples_per_pixel : 1 ) )
+            number_of_tiles            ( round_up_divide( dimensions.y, tile_height ) * tiles_per_row * ( geometry.bits.planar_configuration == PLANARCONFIG_SEPARATE ? geometry.bits.samples_per_pixel : 1 ) )
         {
-            BOOST_ASSERT( tile_width_bytes == unsigned( ::TIFFTileRowSize( &source.lib_object() ) ) );
-            BOOST_ASSERT( tile_size_bytes  == unsigned( ::TIFFTileSize   ( &source.lib_object() ) ) );
-            BOOST_ASSERT( starting_tile + number_of_tiles <= ::TIFFNumberOfTiles( &source.lib_object() ) );
+            BOOST_ASSERT( geometry.tiled );
+            BOOST_ASSERT( tile_width_bytes == unsigned( ::TIFFTileRowSize( &tiff ) ) );
+            BOOST_ASSERT( tile_size_bytes  == unsigned( ::TIFFTileSize   ( &tiff ) ) );
+            BOOST_ASSERT( starting_tile + number_of_tiles <= ::TIFFNumberOfTiles( &tiff ) );
+            ignore_unused_variable_warning( tiff );
             if ( tile_height > static_cast<uint32>( dimensions.y ) )
             {
                 rows_to_read_per_tile = end_rows_to_read = dimensions.y;
@@ -273,7 +602,7 @@ private: // Private backend_base interface.
         unsigned int const tile_width_bytes;
         unsigned int const tile_size_bytes ;
 
-        scoped_array<unsigned char> p_tile_buffer;
+        detail::scratch_buffer<unsigned char> const p_tile_buffer;
 
         unsigned int const last_row_tile_width        ;
         unsigned int const tiles_per_row              ;
@@ -305,95 +634,225 @@ private: // Private backend_base interface.
     {
         cumulative_result result;
 
-        if ( can_do_tile_access() ) /* tiled decoding */
+        // Implementation note:
+        //   A LibTIFF object can only decode one strip/tile at a time so
+        // separate planes can only be decoded in parallel through separate
+        // LibTIFF objects (i.e. only for sources that can be reopened).
+        plane_geometry_t const geometry( *this );
+
+        unsigned int const number_of_threads( std::min( view_data.number_of_planes_, detail::hardware_concurrency() ) );
+        if ( ( number_of_threads > 1 ) && can_reopen() )
         {
-            tile_setup_t setup( *this, view_data.dimensions_, view_data.offset_, false );
+            detail::tiff_memory_source_t memory_source( *this );
+            memory_source.position = 0;
+            plane_worker_t worker( lib_object(), geometry, memory_source, file_name_.c_str(), view_data, number_of_threads );
+            detail::parallel_for( view_data.number_of_planes_, number_of_threads, worker );
+            result.accumulate( worker.succeeded() );
+        }
+        else
+        {
+            for ( unsigned int plane( 0 ); plane < view_data.number_of_planes_; ++plane )
+                read_plane( lib_object(), geometry, view_data, plane, result );
+        }
 
-            ttile_t current_tile( 0 );
+        result.throw_if_error();
+    }
 
-            for ( unsigned int plane( 0 ); plane < view_data.number_of_planes_; ++plane )
+    static void read_plane( TIFF & tiff, plane_geometry_t const & geometry, view_data_t const & view_data, unsigned int const plane, cumulative_result & result )
+    {
+        if ( geometry.tiled ) /* tiled decoding */
+        {
+            tile_setup_t setup( tiff, geometry, view_data.dimensions_, view_data.offset_, false );
+
+            ttile_t const tiles_per_plane        ( setup.number_of_tiles / view_data.number_of_planes_                      );
+            ttile_t const file_tiles_per_plane   ( ::TIFFNumberOfTiles( &tiff ) / view_data.number_of_planes_               );
+            ttile_t const current_plane_end_tile ( plane * file_tiles_per_plane + tiles_per_plane                             );
+
+            unsigned char * p_target( view_data.plane_buffers_[ plane ] );
+            for ( ttile_t current_tile( plane * file_tiles_per_plane + setup.starting_tile ); current_tile < current_plane_end_tile; ++current_tile )
             {
-                unsigned char * p_target( view_data.plane_buffers_[ plane ] );
-                for ( current_tile += setup.starting_tile; current_tile < setup.number_of_tiles; ++current_tile )
+                bool         const last_row_tile        ( !--setup.current_row_tiles_remaining                                     );
+                unsigned int const this_tile_width_bytes( last_row_tile ? setup.last_row_tile_width_bytes : setup.tile_width_bytes );
+
+                result.accumulate_equal
+                (
+                    static_cast<unsigned int>( ::TIFFReadEncodedTile
+                    (
+                        &tiff,
+                        current_tile,
+                        setup.p_tile_buffer.get(),
+                        setup.tile_size_bytes
+                    )),
+                    setup.tile_size_bytes
+                );
+
+                unsigned char const * p_tile_buffer_location( setup.p_tile_buffer.get() + ( setup.rows_to_skip * this_tile_width_bytes ) );
+                unsigned char       * p_target_local        ( p_target                                                                   );
+                for ( unsigned int row( setup.rows_to_skip ); row < setup.rows_to_read_per_tile; ++row )
                 {
-                    bool         const last_row_tile        ( !--setup.current_row_tiles_remaining                                     );
-                    unsigned int const this_tile_width_bytes( last_row_tile ? setup.last_row_tile_width_bytes : setup.tile_width_bytes );
-
-                    result.accumulate_equal
-					(
-						static_cast<unsigned int>( ::TIFFReadEncodedTile
-						(
-							&lib_object(),
-							current_tile,
-							setup.p_tile_buffer.get(),
-							setup.tile_size_bytes
-						)),
-						setup.tile_size_bytes
-					);
-
-                    unsigned char const * p_tile_buffer_location( setup.p_tile_buffer.get() + ( setup.rows_to_skip * this_tile_width_bytes ) );
-                    unsigned char       * p_target_local        ( p_target                                                                   );
-                    for ( unsigned int row( setup.rows_to_skip ); row < setup.rows_to_read_per_tile; ++row )
-                    {
-                        std::memcpy( p_target_local, p_tile_buffer_location, this_tile_width_bytes );
-                        memunit_advance( p_tile_buffer_location, setup.tile_width_bytes );
-                        memunit_advance( p_target_local        , view_data.stride_      );
-                    }
-                    memunit_advance( p_target, this_tile_width_bytes );
-                    if ( last_row_tile )
-                    {
-                        p_target += ( ( setup.rows_to_read_per_tile - 1 - setup.rows_to_skip ) * view_data.stride_ );
-                        setup.rows_to_skip = 0;
-                        setup.current_row_tiles_remaining = setup.tiles_per_row;
-                        bool const next_row_is_last_row( ( setup.number_of_tiles - ( current_tile + 1 ) ) == setup.tiles_per_row );
-                        if ( next_row_is_last_row )
-                            setup.rows_to_read_per_tile = setup.end_rows_to_read;
-                    }
-                    //BOOST_ASSERT( p_tile_buffer_location == ( setup.p_tile_buffer.get() + this_tile_size_bytes ) || ( setup.rows_to_read_per_tile != setup.tile_height ) );
-                    BOOST_ASSERT( p_target <= view_data.plane_buffers_[ plane ] + ( view_data.stride_ * view_data.dimensions_.y ) );
+                    std::memcpy( p_target_local, p_tile_buffer_location, this_tile_width_bytes );
+                    memunit_advance( p_tile_buffer_location, setup.tile_width_bytes );
+                    memunit_advance( p_target_local        , view_data.stride_      );
+                }
+                memunit_advance( p_target, this_tile_width_bytes );
+                if ( last_row_tile )
+                {
+                    p_target += ( ( setup.rows_to_read_per_tile - 1 - setup.rows_to_skip ) * view_data.stride_ );
+                    setup.rows_to_skip = 0;
+                    setup.current_row_tiles_remaining = setup.tiles_per_row;
+                    bool const next_row_is_last_row( ( current_plane_end_tile - ( current_tile + 1 ) ) == setup.tiles_per_row );
+                    if ( next_row_is_last_row )
+                        setup.rows_to_read_per_tile = setup.end_rows_to_read;
                 }
-                BOOST_ASSERT( p_target == view_data.plane_buffers_[ plane ] + ( view_data.stride_ * view_data.dimensions_.y ) );
+                BOOST_ASSERT( p_target <= view_data.plane_buffers_[ plane ] + ( view_data.stride_ * view_data.dimensions_.y ) );
             }
+            BOOST_ASSERT( p_target == view_data.plane_buffers_[ plane ] + ( view_data.stride_ * view_data.dimensions_.y ) );
         }
         else /* row per row decoding */
         {
-            BOOST_ASSERT( ::TIFFScanlineSize( &lib_object() ) <= static_cast<tsize_t>( view_data.stride_ ) );
-            for ( unsigned int plane( 0 ); plane < view_data.number_of_planes_; ++plane )
+            BOOST_ASSERT( ::TIFFScanlineSize( &tiff ) <= static_cast<tsize_t>( view_data.stride_ ) );
+            unsigned char * buf( view_data.plane_buffers_[ plane ] );
+            skip_row_results_t skip_result( skip_to_row( tiff, geometry, view_data.offset_, plane, buf, result ) );
+            ttile_t const number_of_strips( ( view_data.dimensions_.y - skip_result.rows_to_read_using_scanlines + skip_result.rows_per_strip - 1 ) / skip_result.rows_per_strip );
+            skip_result.rows_to_read_using_scanlines = std::min<unsigned int>( skip_result.rows_to_read_using_scanlines, view_data.dimensions_.y );
+
+            unsigned int row( view_data.offset_ );
+            while ( row != ( view_data.offset_ + skip_result.rows_to_read_using_scanlines ) )
             {
-                unsigned char * buf( view_data.plane_buffers_[ plane ] );
-                skip_row_results_t skip_result( skip_to_row( view_data.offset_, plane, buf, result ) );
-                ttile_t const number_of_strips( ( view_data.dimensions_.y - skip_result.rows_to_read_using_scanlines + skip_result.rows_per_strip - 1 ) / skip_result.rows_per_strip );
-                skip_result.rows_to_read_using_scanlines = std::min<unsigned int>( skip_result.rows_to_read_using_scanlines, view_data.dimensions_.y );
+                result.accumulate_greater( ::TIFFReadScanline( &tiff, buf, row++, static_cast<tsample_t>( plane ) ), 0 );
+                buf += view_data.stride_;
+            }
 
-                unsigned int row( view_data.offset_ );
-                while ( row != ( view_data.offset_ + skip_result.rows_to_read_using_scanlines ) )
+            unsigned int const view_strip_increment( view_data.stride_ * skip_result.rows_per_strip );
+            if ( view_strip_increment == static_cast<unsigned int>( ::TIFFStripSize( &tiff ) ) )
+            {
+                for ( unsigned int strip( skip_result.starting_strip ); strip < number_of_strips; ++strip )
                 {
-                    result.accumulate_greater( ::TIFFReadScanline( &lib_object(), buf, row++, static_cast<tsample_t>( plane ) ), 0 );
-                    buf += view_data.stride_;
+                    result.accumulate_greater( ::TIFFReadEncodedStrip( &tiff, strip, buf, view_strip_increment ), 0 );
+                    buf += view_strip_increment;
+                    row += skip_result.rows_per_strip;
                 }
+            }
 
-                unsigned int const view_strip_increment( view_data.stride_ * skip_result.rows_per_strip );
-                if ( view_strip_increment == static_cast<unsigned int>( ::TIFFStripSize( &lib_object() ) ) )
+            unsigned int const target_row( view_data.offset_ + view_data.dimensions_.y );
+            while ( row < target_row )
+            {
+                result.accumulate_greater( ::TIFFReadScanline( &tiff, buf, row++, static_cast<tsample_t>( plane ) ), 0 );
+                buf += view_data.stride_;
+            }
+        }
+    }
+
+    bool can_reopen() const
+    {
+        return ( static_cast<detail::tiff_memory_source_t const &>( *this ).p_begin != 0 ) || !file_name_.empty();
+    }
+
+    /// Opens another LibTIFF object for the same source (a memory range or,
+    /// when that is empty, the named file) positioned at the given directory
+    /// (returns null on failure).
+    static TIFF * reopen( detail::tiff_memory_source_t & memory_source, char const * const file_name, toff_t const directory_offset )
+    {
+        BOOST_ASSERT( memory_source.position == 0 );
+        TIFF * const p_tiff
+        (
+            memory_source.p_begin
+                ? ::TIFFClientOpen
+                  (
+                      "", "rM",
+                          &memory_source,
+                          &detail::memory_read_proc,
+                          &detail::memory_write_proc,
+                          &detail::memory_seek_proc,
+                          &detail::memory_close_proc,
+                          &detail::memory_size_proc,
+                          &detail::memory_map_proc,
+                          &detail::memory_unmap_proc
+                  )
+                : ::TIFFOpen( file_name, "r" )
+        );
+        if ( p_tiff && !::TIFFSetSubDirectory( p_tiff, directory_offset ) )
+        {
+            ::TIFFClose( p_tiff );
+            return 0;
+        }
+        return p_tiff;
+    }
+
+    class plane_worker_t : boost::noncopyable
+    {
+    public:
+        plane_worker_t
+        (
+            TIFF                               & own_tiff         ,
+            plane_geometry_t             const & geometry         ,
+            detail::tiff_memory_source_t const & memory_source    ,
+            char                         const * file_name        ,
+            view_data_t                  const & view_data        ,
+            unsigned int                         number_of_workers
+        )
+            :
+            own_tiff_      ( own_tiff                            ),
+            geometry_      ( geometry                            ),
+            file_name_     ( file_name                           ),
+            view_data_     ( view_data                           ),
+            memory_sources_( number_of_workers, memory_source    ),
+            tiffs_         ( number_of_workers, 0                ),
+            succeeded_     ( view_data.number_of_planes_, true   )
+        {}
+
+        ~plane_worker_t()
+        {
+            for ( unsigned int worker( 0 ); worker < tiffs_.size(); ++worker )
+                if ( tiffs_[ worker ] )
+                    ::TIFFClose( tiffs_[ worker ] );
+        }
+
+        void operator()( unsigned int const plane, unsigned int const worker )
+        {
+            // Exceptions must not escape the worker threads.
+            try
+            {
+                cumulative_result result;
+                // The calling thread (worker 0) exclusively uses the reader's
+                // own LibTIFF object, every other worker reopens the source
+                // once (the handles are owned and closed by the plane_worker_t
+                // so they are not leaked if read_plane() throws).
+                TIFF * p_tiff( &own_tiff_ );
+                if ( worker != 0 )
                 {
-                    for ( unsigned int strip( skip_result.starting_strip ); strip < number_of_strips; ++strip )
+                    TIFF * & p_worker_tiff( tiffs_[ worker ] );
+                    if ( !p_worker_tiff )
+                        p_worker_tiff = reopen( memory_sources_[ worker ], file_name_, geometry_.directory_offset );
+                    if ( !p_worker_tiff )
                     {
-                        result.accumulate_greater( ::TIFFReadEncodedStrip( &lib_object(), strip, buf, view_strip_increment ), 0 );
-                        buf += view_strip_increment;
-                        row += skip_result.rows_per_strip;
+                        succeeded_[ plane ] = false;
+                        return;
                     }
+                    p_tiff = p_worker_tiff;
                 }
-
-                unsigned int const target_row( view_data.offset_ + view_data.dimensions_.y );
-                while ( row < target_row )
-                {
-                    result.accumulate_greater( ::TIFFReadScanline( &lib_object(), buf, row++, static_cast<tsample_t>( plane ) ), 0 );
-                    buf += view_data.stride_;
-                }
+                read_plane( *p_tiff, geometry_, view_data_, plane, result );
+                succeeded_[ plane ] = !result.failed();
+            }
+            catch ( ... )
+            {
+                succeeded_[ plane ] = false;
             }
         }
 
-        result.throw_if_error();
-    }
+        bool succeeded() const { return std::find( succeeded_.begin(), succeeded_.end(), false ) == succeeded_.end(); }
+
+    private:
+        TIFF                                    &       own_tiff_      ;
+        plane_geometry_t                  const &       geometry_      ;
+        char                              const * const file_name_     ;
+        view_data_t                       const &       view_data_     ;
+        // Every reopened LibTIFF object reads through (and keeps a pointer
+        // to) its own copy of the memory source.
+        std::vector<detail::tiff_memory_source_t>       memory_sources_;
+        std::vector<TIFF *>                             tiffs_         ;
+        std::vector<unsigned char>                      succeeded_     ;
+    }; // class plane_worker_t
 
 
     ////////////////////////////////////////////////////////////////////////////
@@ -461,7 +920,8 @@ private: // Private backend_base interface.
         {
             tile_setup_t setup
             (
-                *this,
+                lib_object(),
+                plane_geometry_t( *this ),
                 dimensions,
                 get_offset<offset_t>( view ),
                 nondirect_planar_to_contig_conversion_t::value
@@ -615,6 +1075,7 @@ private: // Private backend_base interface.
         ////////////////////////////////////////////////////////////////////////
         {
             scanline_buffer_t<my_pixel_t> const scanline_buffer( *this, nondirect_planar_to_contig_conversion_t::value() );
+            plane_geometry_t              const geometry       ( *this                                                  );
 
             if ( nondirect_planar_to_contig_conversion_t::value )
             {
@@ -638,7 +1099,7 @@ private: // Private backend_base interface.
                     {
                         tdata_t const p_buffer( &(*buffer_iterator)[ plane ] );
                         //...zzz...yup...not the most efficient thing in the universe...
-                        skip_to_row( get_offset<offset_t>( view ) + row, plane, p_buffer, result );
+                        skip_to_row( lib_object(), geometry, get_offset<offset_t>( view ) + row, plane, p_buffer, result );
                         result.accumulate_greater( ::TIFFReadScanline( &lib_object(), p_buffer, row, static_cast<tsample_t>( plane ) ), 0 );
                     }
                     typename          MyView       ::x_iterator p_source_pixel( buffer_iterator );
@@ -658,7 +1119,7 @@ private: // Private backend_base interface.
                 for ( unsigned int plane( 0 ); plane < number_of_planes_t::value; ++plane )
                 {
                     if ( is_offset_view<TargetView>::value )
-                        skip_to_row( get_offset<offset_t>( view ), plane, scanline_buffer.begin(), result );
+                        skip_to_row( lib_object(), geometry, get_offset<offset_t>( view ), plane, scanline_buffer.begin(), result );
 
                     local_target_view_t const & target_view( adjust_target_to_my_view( original_view( view ), plane, is_planar<MyView>() ) );
                     target_y_iterator p_target( target_view.y_at( 0, 0 ) );
@@ -765,21 +1226,19 @@ private:
     protected:
         explicit scanline_buffer_base_t( std::size_t const size )
             :
-            p_begin_( new unsigned char[ size ] ),
-            p_end_  ( p_begin_ + size           )
+            buffer_( size                      ),
+            p_end_ ( buffer_.get() + size      )
         {}
 
         // This one makes the end pointer point to the end of the scanline/row
         // of the first plane not the end of the buffer itself...ugh...to be cleaned up...
         explicit scanline_buffer_base_t( std::pair<std::size_t, std::size_t> const size_to_allocate_size_to_report_pair )
             :
-            p_begin_( new unsigned char[ size_to_allocate_size_to_report_pair.first ] ),
-            p_end_  ( p_begin_ + size_to_allocate_size_to_report_pair.second          )
+            buffer_( size_to_allocate_size_to_report_pair.first                  ),
+            p_end_ ( buffer_.get() + size_to_allocate_size_to_report_pair.second )
         {}
 
-        ~scanline_buffer_base_t() { delete[] p_begin_; }
-
-        BF_NOTHROWNORESTRICTNOALIAS unsigned char       * begin() const { return p_begin_; }
+        BF_NOTHROWNORESTRICTNOALIAS unsigned char       * begin() const { return buffer_.get(); }
         BF_NOTHROWNORESTRICTNOALIAS unsigned char const * end  () const { return p_end_  ; }
 
         static std::size_t scanline_buffer_construction( libtiff_image const & tiff )
@@ -796,8 +1255,8 @@ private:
         }
 
     private:
-        unsigned char       * const p_begin_;
-        unsigned char const * const p_end_  ;
+        detail::scratch_buffer<unsigned char> const buffer_;
+        unsigned char const *                 const p_end_ ;
     };
 
     template <typename Pixel>
@@ -818,26 +1277,29 @@ private:
         planar_scanline_buffer_t( libtiff_image const & image ) : scanline_buffer_t<Pixel>( tiff, mpl::true_() ) {}
     };
 
-    skip_row_results_t BF_NOTHROWNOALIAS skip_to_row
+    static skip_row_results_t BF_NOTHROWNOALIAS skip_to_row
     (
-        unsigned int        const row_to_skip_to,
-        unsigned int        const sample,
-        tdata_t             const buffer,
-        cumulative_result &       error_result
-    ) const
+        TIFF                         & tiff,
+        plane_geometry_t       const & geometry,
+        unsigned int           const   row_to_skip_to,
+        unsigned int           const   sample,
+        tdata_t                const   buffer,
+        cumulative_result            & error_result
+    )
     {
-        BOOST_ASSERT( !::TIFFIsTiled( &lib_object() ) );
+        BOOST_ASSERT( !::TIFFIsTiled( &tiff ) );
+        BOOST_ASSERT( !geometry.tiled         );
 
         skip_row_results_t result;
-        result.rows_per_strip               = get_field<uint32>( TIFFTAG_ROWSPERSTRIP );
+        result.rows_per_strip               = geometry.rows_per_strip;
         unsigned int const number_of_rows_to_skip_using_scanlines( row_to_skip_to % result.rows_per_strip );
-        result.starting_strip               = ( row_to_skip_to / result.rows_per_strip ) + ( number_of_rows_to_skip_using_scanlines != 0 ) + sample * get_field<uint32>( TIFFTAG_IMAGEWIDTH );
+        result.starting_strip               = ( row_to_skip_to / result.rows_per_strip ) + ( number_of_rows_to_skip_using_scanlines != 0 ) + sample * geometry.image_width;
         result.rows_to_read_using_scanlines = row_to_skip_to ? ( result.rows_per_strip - number_of_rows_to_skip_using_scanlines - 1 ) : 0;
 
         bool const canSkipDirectly
         (
-            ( result.rows_per_strip                    == 1                ) ||
-            ( get_field<uint16>( TIFFTAG_COMPRESSION ) == COMPRESSION_NONE )
+            ( result.rows_per_strip == 1                ) ||
+            ( geometry.compression  == COMPRESSION_NONE )
         );
         unsigned int row
         (
@@ -847,16 +1309,21 @@ private:
         );
         while ( row < row_to_skip_to )
         {
-            error_result.accumulate_greater( ::TIFFReadScanline( &lib_object(), buffer, row++, static_cast<tsample_t>( sample ) ), 0 );
+            error_result.accumulate_greater( ::TIFFReadScanline( &tiff, buffer, row++, static_cast<tsample_t>( sample ) ), 0 );
         }
 
-        //BOOST_ASSERT( !row_to_skip_to || ( ::TIFFCurrentRow( &lib_object() ) == row_to_skip_to ) );
+        //BOOST_ASSERT( !row_to_skip_to || ( ::TIFFCurrentRow( &tiff ) == row_to_skip_to ) );
 
         return result;
     }
 
 private:
-    full_format_t const format_;
+    std::string           const  file_name_   ; // for reopen()
+    full_format_t                format_      ;
+    mutable page_table_t         pages_       ;
+    unsigned int                 current_page_;
+    tile_cache *                 p_tile_cache_;
+    uint64_t                     source_id_   ;
 }; // class libtiff_image::native_reader
 
 //------------------------------------------------------------------------------
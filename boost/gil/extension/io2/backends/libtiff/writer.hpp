@@ -24,8 +24,16 @@
 
 #include "boost/gil/extension/io2/detail/io_error.hpp"
 #include "boost/gil/extension/io2/detail/libx_shared.hpp"
+#include "boost/gil/extension/io2/detail/parallel.hpp"
 #include "boost/gil/extension/io2/detail/platform_specifics.hpp"
 #include "boost/gil/extension/io2/detail/shared.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <string>
+#include <vector>
 //------------------------------------------------------------------------------
 namespace boost
 {
@@ -36,10 +44,103 @@ namespace gil
 namespace io
 {
 //------------------------------------------------------------------------------
+
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \class tiff_writer_options
+///
+/// \brief Encoding settings for libtiff_image::native_writer.
+///
+/// Zero/negative values select the LibTIFF defaults.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+struct tiff_writer_options
+{
+    enum compression_t
+    {
+        none     = COMPRESSION_NONE         ,
+        lzw      = COMPRESSION_LZW          ,
+        jpeg     = COMPRESSION_JPEG         ,
+        deflate  = COMPRESSION_ADOBE_DEFLATE,
+        packbits = COMPRESSION_PACKBITS
+    #ifdef COMPRESSION_LZMA
+       ,lzma     = COMPRESSION_LZMA
+    #endif // COMPRESSION_LZMA
+    #ifdef COMPRESSION_ZSTD
+       ,zstd     = COMPRESSION_ZSTD
+    #endif // COMPRESSION_ZSTD
+    };
+
+    enum predictor_t
+    {
+        no_predictor   = PREDICTOR_NONE         ,
+        horizontal     = PREDICTOR_HORIZONTAL   , ///< integer samples
+        floating_point = PREDICTOR_FLOATINGPOINT  ///< IEEE floating point samples
+    };
+
+    enum file_format_t
+    {
+        automatic_format, ///< BigTIFF only if the output could exceed 4 GB
+        classic_tiff    ,
+        big_tiff
+    };
+
+    tiff_writer_options()
+        :
+        compression    ( none             ),
+        predictor      ( no_predictor     ),
+        level          ( -1               ),
+        rows_per_strip ( 0                ),
+        tile_dimensions( 0, 0             ),
+        file_format    ( automatic_format )
+    {}
+
+    compression_t  compression    ;
+    predictor_t    predictor      ; ///< LZW, Deflate, LZMA and ZSTD only
+    int            level          ; ///< JPEG quality [1, 100], Deflate [1, 9], LZMA preset [0, 9], ZSTD [1, 22]
+    uint32         rows_per_strip ; ///< stripped output only
+    point2<uint32> tile_dimensions; ///< non-zero selects tiled output (multiples of 16)
+    file_format_t  file_format    ;
+}; // struct tiff_writer_options
+
+
 namespace detail
 {
 //------------------------------------------------------------------------------
 
+/// The codec specific 'pseudo tag' that holds the compression level/quality
+/// (zero if there is none).
+inline ttag_t tiff_compression_level_tag( unsigned int const compression )
+{
+    switch ( compression )
+    {
+        case COMPRESSION_JPEG         : return TIFFTAG_JPEGQUALITY;
+        case COMPRESSION_DEFLATE      :
+        case COMPRESSION_ADOBE_DEFLATE: return TIFFTAG_ZIPQUALITY ;
+    #ifdef COMPRESSION_LZMA
+        case COMPRESSION_LZMA         : return TIFFTAG_LZMAPRESET ;
+    #endif // COMPRESSION_LZMA
+    #ifdef COMPRESSION_ZSTD
+        case COMPRESSION_ZSTD         : return TIFFTAG_ZSTD_LEVEL ;
+    #endif // COMPRESSION_ZSTD
+        default                       : return 0                  ;
+    }
+}
+
+
+template <typename Handle>
+tsize_t write( thandle_t const handle, tdata_t const buf, tsize_t const size )
+{
+    return static_cast<tsize_t>( output_device<Handle>::write( buf, size, reinterpret_cast<Handle>( handle ) ) );
+}
+
+inline tsize_t no_read_proc( thandle_t /*handle*/, tdata_t /*buf*/, tsize_t /*size*/ )
+{
+    return 0;
+}
+
+
 struct tiff_writer_view_data_t : tiff_view_data_t
 {
     template <class View>
@@ -53,6 +154,440 @@ struct tiff_writer_view_data_t : tiff_view_data_t
     full_format_t format_;
 };
 
+
+/// Type erased description of the (possibly planar) pixels of a view or an
+/// internally generated image (e.g. an overview).
+struct tiff_raster_t
+{
+    tiff_raster_t() {}
+
+    explicit tiff_raster_t( tiff_view_data_t const & view )
+        :
+        dimensions      ( view.dimensions_       ),
+        stride          ( view.stride_           ),
+        number_of_planes( view.number_of_planes_ )
+    {
+        std::copy( view.plane_buffers_.begin(), view.plane_buffers_.end(), plane_buffers.begin() );
+    }
+
+    point2<uint32>            dimensions      ;
+    unsigned int              stride          ;
+    unsigned int              number_of_planes;
+    array<unsigned char *, 4> plane_buffers   ;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \class tiff_memory_sink_t
+/// \internal
+/// \brief Client data (thandle_t) for writing TIFFs into a growable buffer.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+struct tiff_memory_sink_t
+{
+    tiff_memory_sink_t() : position( 0 ) {}
+
+    void clear() { buffer.clear(); position = 0; }
+
+    std::vector<unsigned char> buffer  ;
+    toff_t                     position;
+}; // struct tiff_memory_sink_t
+
+inline tiff_memory_sink_t & memory_sink( thandle_t const handle )
+{
+    BOOST_ASSERT( handle );
+    return *static_cast<tiff_memory_sink_t *>( handle );
+}
+
+inline tsize_t memory_sink_read_proc( thandle_t const handle, tdata_t const buf, tsize_t const size )
+{
+    tiff_memory_sink_t & sink( memory_sink( handle ) );
+    toff_t  const available    ( ( sink.position < sink.buffer.size() ) ? sink.buffer.size() - sink.position : 0 );
+    tsize_t const bytes_to_read( static_cast<tsize_t>( std::min<toff_t>( size, available ) ) );
+    if ( bytes_to_read )
+        std::memcpy( buf, &sink.buffer[ static_cast<std::size_t>( sink.position ) ], bytes_to_read );
+    sink.position += bytes_to_read;
+    return bytes_to_read;
+}
+
+inline tsize_t memory_sink_write_proc( thandle_t const handle, tdata_t const buf, tsize_t const size )
+{
+    tiff_memory_sink_t & sink( memory_sink( handle ) );
+    std::size_t const end( static_cast<std::size_t>( sink.position ) + size );
+    // Exceptions must not propagate through LibTIFF: report a failed write.
+    if ( end > sink.buffer.size() )
+    {
+        try { sink.buffer.resize( end ); }
+        catch ( std::bad_alloc const & ) { return 0; }
+    }
+    std::memcpy( &sink.buffer[ static_cast<std::size_t>( sink.position ) ], buf, size );
+    sink.position = end;
+    return size;
+}
+
+inline toff_t memory_sink_seek_proc( thandle_t const handle, toff_t const off, int const whence )
+{
+    tiff_memory_sink_t & sink( memory_sink( handle ) );
+    switch ( whence )
+    {
+        case SEEK_SET: sink.position  = off                      ; break;
+        case SEEK_CUR: sink.position += off                      ; break;
+        case SEEK_END: sink.position  = sink.buffer.size() + off ; break;
+        default: BF_UNREACHABLE_CODE
+    }
+    return sink.position;
+}
+
+inline toff_t memory_sink_size_proc( thandle_t const handle )
+{
+    return memory_sink( handle ).buffer.size();
+}
+
+inline int memory_sink_map_proc( thandle_t /*handle*/, tdata_t * /*pbase*/, toff_t * /*psize*/ )
+{
+    return false;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \class tiff_tile_writer
+/// \internal
+/// \brief Writes a view as TIFF tiles, compressing them in parallel.
+///
+/// LibTIFF codecs keep their state in the TIFF object so a single TIFF object
+/// can only compress one tile at a time. Each tile is therefore compressed by
+/// a worker through its own, short lived, in-memory single tile TIFF object
+/// (configured with the same codec settings) and the resulting compressed
+/// bytes are then appended to the target, in tile order, with
+/// TIFFWriteRawTile(). The tiles are processed in batches to bound the memory
+/// used for the compressed results.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+class tiff_tile_writer : noncopyable
+{
+public:
+    tiff_tile_writer( TIFF & target, tiff_raster_t const & source, unsigned int const bytes_per_pixel, unsigned int const number_of_threads )
+        :
+        target_           ( target                                              ),
+        source_           ( source                                              ),
+        bytes_per_pixel_  ( bytes_per_pixel                                     ),
+        tile_width_       ( get_field<uint32>( TIFFTAG_TILEWIDTH  )             ),
+        tile_height_      ( get_field<uint32>( TIFFTAG_TILELENGTH )             ),
+        tiles_across_     ( ( source.dimensions.x + tile_width_  - 1 ) / tile_width_  ),
+        tiles_per_plane_  ( tiles_across_ * ( ( source.dimensions.y + tile_height_ - 1 ) / tile_height_ ) ),
+        number_of_tiles_  ( tiles_per_plane_ * source.number_of_planes          ),
+        tile_size_        ( tile_width_ * tile_height_ * bytes_per_pixel        ),
+        compression_      ( get_field<uint16>( TIFFTAG_COMPRESSION )            ),
+        planar_           ( get_field<uint16>( TIFFTAG_PLANARCONFIG ) == PLANARCONFIG_SEPARATE ),
+        bits_per_sample_  ( get_field<uint16>( TIFFTAG_BITSPERSAMPLE   )        ),
+        samples_per_pixel_( planar_ ? 1 : get_field<uint16>( TIFFTAG_SAMPLESPERPIXEL ) ),
+        sample_format_    ( get_field<uint16>( TIFFTAG_SAMPLEFORMAT    )        ),
+        photometric_      ( planar_ ? uint16( PHOTOMETRIC_MINISBLACK ) : get_field<uint16>( TIFFTAG_PHOTOMETRIC ) ),
+        predictor_        ( get_field<uint16>( TIFFTAG_PREDICTOR       )        ),
+        level_tag_        ( tiff_compression_level_tag( compression_ )          ),
+        level_            ( -1                                                  ),
+        number_of_threads_( ( compression_ == COMPRESSION_NONE ) || ( compression_ == COMPRESSION_JPEG ) || ( compression_ == COMPRESSION_OJPEG ) ? 1 : number_of_threads ),
+        batch_size_       ( number_of_threads_ * 4                              ),
+        batch_begin_      ( 0                                                   ),
+        tile_buffers_     ( number_of_threads_, std::vector<unsigned char>( tile_size_ ) ),
+        compressed_tiles_ ( batch_size_                                         ),
+        compressed_ok_    ( batch_size_                                         )
+    {
+        BOOST_ASSERT( tile_size_ == ::TIFFTileSize( &target ) );
+        if ( level_tag_ && !::TIFFGetField( &target_, level_tag_, &level_ ) )
+            level_tag_ = 0;
+    }
+
+    void write( cumulative_result & result )
+    {
+        if ( number_of_threads_ == 1 )
+        {
+            // Uncompressed (memcpy bound) or codecs with shared state (JPEG
+            // tables): let libtiff do everything in place.
+            for ( ttile_t tile( 0 ); tile < number_of_tiles_; ++tile )
+            {
+                assemble_tile( tile, tile_buffers_.front() );
+                result.accumulate_greater( ::TIFFWriteEncodedTile( &target_, tile, &tile_buffers_.front()[ 0 ], tile_size_ ), 0 );
+            }
+            return;
+        }
+
+        for ( batch_begin_ = 0; batch_begin_ < number_of_tiles_; batch_begin_ += batch_size_ )
+        {
+            unsigned int const batch_tiles( std::min<unsigned int>( batch_size_, number_of_tiles_ - batch_begin_ ) );
+            parallel_for( batch_tiles, number_of_threads_, *this );
+            for ( unsigned int slot( 0 ); slot < batch_tiles; ++slot )
+            {
+                result.accumulate( compressed_ok_[ slot ] != 0 );
+                tiff_memory_sink_t const & compressed( compressed_tiles_[ slot ] );
+                result.accumulate_greater
+                (
+                    ::TIFFWriteRawTile
+                    (
+                        &target_,
+                        batch_begin_ + slot,
+                        const_cast<unsigned char *>( &compressed.buffer[ static_cast<std::size_t>( compressed.position ) ] ),
+                        static_cast<tsize_t>( compressed.buffer.size() - compressed.position )
+                    ),
+                    0
+                );
+            }
+        }
+    }
+
+    // parallel_for() worker interface
+    // (the workers only read the codec settings cached by the constructor:
+    // LibTIFF's field getters are not thread safe, TIFFGetFieldDefaulted()
+    // may even modify the target TIFF object).
+    void operator()( unsigned int const slot, unsigned int const worker )
+    {
+        // Exceptions must not escape the worker threads.
+        try
+        {
+            std::vector<unsigned char> & tile_buffer( tile_buffers_[ worker ] );
+            assemble_tile( batch_begin_ + slot, tile_buffer );
+            compressed_ok_[ slot ] = compress_tile( tile_buffer, compressed_tiles_[ slot ] );
+        }
+        catch ( ... )
+        {
+            compressed_ok_[ slot ] = false;
+        }
+    }
+
+private:
+    void assemble_tile( ttile_t const tile, std::vector<unsigned char> & tile_buffer ) const
+    {
+        unsigned int const plane         ( tile / tiles_per_plane_                         );
+        unsigned int const tile_in_plane ( tile % tiles_per_plane_                         );
+        uint32       const x             ( ( tile_in_plane % tiles_across_ ) * tile_width_  );
+        uint32       const y             ( ( tile_in_plane / tiles_across_ ) * tile_height_ );
+        uint32       const columns       ( std::min( tile_width_ , source_.dimensions.x - x ) );
+        uint32       const rows          ( std::min( tile_height_, source_.dimensions.y - y ) );
+        std::size_t  const tile_row_bytes( tile_width_ * bytes_per_pixel_                  );
+
+        // Edge tiles are padded with zeros (which also compress best).
+        if ( ( columns != tile_width_ ) || ( rows != tile_height_ ) )
+            std::fill( tile_buffer.begin(), tile_buffer.end(), 0 );
+
+        unsigned char const * p_source( source_.plane_buffers[ plane ] + y * source_.stride + x * bytes_per_pixel_ );
+        unsigned char       * p_target( &tile_buffer[ 0 ]                                                         );
+        for ( uint32 row( 0 ); row < rows; ++row )
+        {
+            std::memcpy( p_target, p_source, columns * bytes_per_pixel_ );
+            p_source += source_.stride;
+            p_target += tile_row_bytes;
+        }
+    }
+
+    bool compress_tile( std::vector<unsigned char> & tile_buffer, tiff_memory_sink_t & compressed ) const
+    {
+        compressed.clear();
+        TIFF * const p_tile_tiff
+        (
+            ::TIFFClientOpen
+            (
+                "", "w", &compressed,
+                &memory_sink_read_proc, &memory_sink_write_proc, &memory_sink_seek_proc,
+                &memory_close_proc, &memory_sink_size_proc, &memory_sink_map_proc, &memory_unmap_proc
+            )
+        );
+        if ( !p_tile_tiff )
+            return false;
+
+        TIFF & tile_tiff( *p_tile_tiff );
+        // Separate planes are compressed as single sample tiles (which is
+        // what the predictor and the codecs do for them in the target).
+        ::TIFFSetField( &tile_tiff, TIFFTAG_IMAGEWIDTH     , tile_width_        );
+        ::TIFFSetField( &tile_tiff, TIFFTAG_IMAGELENGTH    , tile_height_       );
+        ::TIFFSetField( &tile_tiff, TIFFTAG_TILEWIDTH      , tile_width_        );
+        ::TIFFSetField( &tile_tiff, TIFFTAG_TILELENGTH     , tile_height_       );
+        ::TIFFSetField( &tile_tiff, TIFFTAG_BITSPERSAMPLE  , bits_per_sample_   );
+        ::TIFFSetField( &tile_tiff, TIFFTAG_SAMPLESPERPIXEL, samples_per_pixel_ );
+        ::TIFFSetField( &tile_tiff, TIFFTAG_SAMPLEFORMAT   , sample_format_     );
+        ::TIFFSetField( &tile_tiff, TIFFTAG_PLANARCONFIG   , PLANARCONFIG_CONTIG );
+        ::TIFFSetField( &tile_tiff, TIFFTAG_PHOTOMETRIC    , photometric_       );
+        ::TIFFSetField( &tile_tiff, TIFFTAG_COMPRESSION    , compression_       );
+        ::TIFFSetField( &tile_tiff, TIFFTAG_PREDICTOR      , predictor_         );
+        if ( level_tag_ )
+            ::TIFFSetField( &tile_tiff, level_tag_, level_ );
+
+        // Note: the codecs may modify the input buffer in place (predictor).
+        bool success( ::TIFFWriteEncodedTile( &tile_tiff, 0, &tile_buffer[ 0 ], tile_size_ ) > 0 );
+        toff_t * p_offsets    ( 0 );
+        toff_t * p_byte_counts( 0 );
+        success = success &&
+            ::TIFFGetField( &tile_tiff, TIFFTAG_TILEOFFSETS   , &p_offsets     ) &&
+            ::TIFFGetField( &tile_tiff, TIFFTAG_TILEBYTECOUNTS, &p_byte_counts );
+        if ( success )
+        {
+            // Reuse the sink position/size pair to delimit the compressed tile.
+            BOOST_ASSERT( p_offsets[ 0 ] + p_byte_counts[ 0 ] <= compressed.buffer.size() );
+            compressed.buffer.resize( static_cast<std::size_t>( p_offsets[ 0 ] + p_byte_counts[ 0 ] ) );
+            compressed.position = p_offsets[ 0 ];
+        }
+        // Discard the (unwritten) directory.
+        ::TIFFCleanup( &tile_tiff );
+        return success;
+    }
+
+    template <typename T>
+    T get_field( ttag_t const tag ) const
+    {
+        T value;
+        BOOST_VERIFY( ::TIFFGetFieldDefaulted( &target_, tag, &value ) );
+        return value;
+    }
+
+private:
+    TIFF                          & target_           ;
+    tiff_raster_t           const & source_           ;
+    unsigned int            const   bytes_per_pixel_  ;
+    uint32                  const   tile_width_       ;
+    uint32                  const   tile_height_      ;
+    unsigned int            const   tiles_across_     ;
+    unsigned int            const   tiles_per_plane_  ;
+    ttile_t                 const   number_of_tiles_  ;
+    tsize_t                 const   tile_size_        ;
+    uint16                  const   compression_      ;
+    bool                    const   planar_           ;
+    uint16                  const   bits_per_sample_  ;
+    uint16                  const   samples_per_pixel_;
+    uint16                  const   sample_format_    ;
+    uint16                  const   photometric_      ;
+    uint16                  const   predictor_        ;
+    ttag_t                          level_tag_        ;
+    int                             level_            ;
+    unsigned int            const   number_of_threads_;
+    unsigned int            const   batch_size_       ;
+    unsigned int                    batch_begin_      ;
+
+    std::vector<std::vector<unsigned char> > tile_buffers_    ; // per worker
+    std::vector<tiff_memory_sink_t         > compressed_tiles_; // per batch slot
+    std::vector<unsigned char              > compressed_ok_   ; // per batch slot
+}; // class tiff_tile_writer
+
+
+
+template <typename Sample, typename Accumulator>
+void box_reduce( tiff_raster_t const & source, tiff_raster_t const & target, unsigned int const samples_per_pixel )
+{
+    Accumulator const rounding( std::numeric_limits<Sample>::is_integer ? 2 : 0 );
+    for ( unsigned int plane( 0 ); plane < source.number_of_planes; ++plane )
+    {
+        for ( uint32 y( 0 ); y < target.dimensions.y; ++y )
+        {
+            // Odd source dimensions: the last row/column is 'averaged' with itself.
+            uint32 const source_y( 2 * y );
+            Sample const * const p_top   ( reinterpret_cast<Sample const *>( source.plane_buffers[ plane ] + source_y                                          * source.stride ) );
+            Sample const * const p_bottom( reinterpret_cast<Sample const *>( source.plane_buffers[ plane ] + std::min( source_y + 1, source.dimensions.y - 1 ) * source.stride ) );
+            Sample       *       p_target( reinterpret_cast<Sample       *>( target.plane_buffers[ plane ] + y                                                 * target.stride ) );
+            for ( uint32 x( 0 ); x < target.dimensions.x; ++x )
+            {
+                unsigned int const left ( 2 * x                                           * samples_per_pixel );
+                unsigned int const right( std::min( 2 * x + 1, source.dimensions.x - 1 ) * samples_per_pixel );
+                for ( unsigned int sample( 0 ); sample < samples_per_pixel; ++sample )
+                {
+                    Accumulator const sum
+                    (
+                        Accumulator( p_top   [ left + sample ] ) + p_top   [ right + sample ] +
+                        Accumulator( p_bottom[ left + sample ] ) + p_bottom[ right + sample ]
+                    );
+                    *p_target++ = static_cast<Sample>( ( sum + rounding ) / 4 );
+                }
+            }
+        }
+    }
+}
+
+inline bool box_reduce( tiff_raster_t const & source, tiff_raster_t const & target, full_format_t::format_bitfield const & format )
+{
+    unsigned int const samples_per_pixel( ( format.planar_configuration == PLANARCONFIG_CONTIG ) ? format.samples_per_pixel : 1 );
+    switch ( ( format.sample_format << 8 ) | format.bits_per_sample )
+    {
+        case ( SAMPLEFORMAT_UINT << 8 ) |  8: box_reduce<uint8 , uint32>( source, target, samples_per_pixel ); return true;
+        case ( SAMPLEFORMAT_UINT << 8 ) | 16: box_reduce<uint16, uint32>( source, target, samples_per_pixel ); return true;
+        case ( SAMPLEFORMAT_INT  << 8 ) |  8: box_reduce<int8  , int32 >( source, target, samples_per_pixel ); return true;
+        case ( SAMPLEFORMAT_INT  << 8 ) | 16: box_reduce<int16 , int32 >( source, target, samples_per_pixel ); return true;
+        default: return false;
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \class tiff_overview_pyramid
+/// \internal
+/// \brief Reduced resolution (overview) levels of an image.
+///
+/// Each level halves the dimensions of the previous one (2x2 box filter) and
+/// is produced in a single, sequential pass over the previous level. Levels
+/// are added until the maximum number of levels is reached or until the
+/// previous level fits into a single tile.
+///
+/// All the levels are kept in memory (the COG layout writes them smallest
+/// first, before the full resolution image): 1/4 + 1/16 + ... i.e. less than
+/// one third of the size of the full resolution image.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+class tiff_overview_pyramid : noncopyable
+{
+public:
+    tiff_overview_pyramid
+    (
+        tiff_raster_t                  const & full_resolution,
+        full_format_t::format_bitfield const & format,
+        unsigned int                   const   max_levels,
+        point2<uint32>                 const & tile_dimensions
+    )
+    {
+        io_error_if( format.bits_per_sample % 8 != 0, "Unsupported format for TIFF overviews." );
+        unsigned int const bytes_per_pixel
+        (
+            format.bits_per_sample / 8 * ( ( format.planar_configuration == PLANARCONFIG_CONTIG ) ? format.samples_per_pixel : 1 )
+        );
+
+        point2<uint32> dimensions( full_resolution.dimensions );
+        while ( ( levels_.size() < max_levels ) && ( ( dimensions.x > tile_dimensions.x ) || ( dimensions.y > tile_dimensions.y ) ) )
+        {
+            dimensions = point2<uint32>( ( dimensions.x + 1 ) / 2, ( dimensions.y + 1 ) / 2 );
+            tiff_raster_t level;
+            level.dimensions       = dimensions;
+            level.stride           = dimensions.x * bytes_per_pixel;
+            level.number_of_planes = full_resolution.number_of_planes;
+            levels_.push_back( level );
+        }
+
+        // All buffers are allocated up front so that the plane pointers remain
+        // stable.
+        buffers_.resize( levels_.size() );
+        tiff_raster_t const * p_source( &full_resolution );
+        for ( unsigned int level( 0 ); level < levels_.size(); ++level )
+        {
+            tiff_raster_t & target( levels_[ level ] );
+            std::size_t const plane_size( target.stride * target.dimensions.y );
+            buffers_[ level ].resize( plane_size * target.number_of_planes );
+            for ( unsigned int plane( 0 ); plane < target.number_of_planes; ++plane )
+                target.plane_buffers[ plane ] = &buffers_[ level ][ plane * plane_size ];
+            io_error_if_not( box_reduce( *p_source, target, format ), "Unsupported format for TIFF overviews." );
+            p_source = &target;
+        }
+    }
+
+    unsigned int levels() const { return static_cast<unsigned int>( levels_.size() ); }
+
+    /// Overview levels are numbered from 1 (level 0 is the full resolution image).
+    tiff_raster_t const & level( unsigned int const level ) const { BOOST_ASSERT( level > 0 ); return levels_[ level - 1 ]; }
+
+private:
+    std::vector<tiff_raster_t             > levels_ ;
+    std::vector<std::vector<unsigned char> > buffers_;
+}; // class tiff_overview_pyramid
+
 //------------------------------------------------------------------------------
 } // namespace detail
 
@@ -63,27 +598,264 @@ class libtiff_image::native_writer
     public detail::configure_on_write_writer
 {
 public:
-    explicit native_writer( char const * const file_name ) : libtiff_image( file_name, "w" ) {}
+    // Implementation note:
+    //   The classic TIFF vs BigTIFF choice has to be made when the LibTIFF
+    // object is created (the header gets written immediately) so creation is
+    // deferred to write_default()/begin()/write(), when the image (size) is
+    // known, or to the first lib_object() access (for configuring the output
+    // of write() directly) in which case the file_format option decides.
+    explicit native_writer( char const * const file_name )
+        :
+        file_name_        ( file_name ),
+        device_handle_    ( 0         ),
+        p_open_device_    ( 0         ),
+        number_of_threads_( 0         ),
+        overview_levels_  ( 0         ),
+        streamed_height_  ( 0         ),
+        next_row_         ( 0         )
+    {
+        BOOST_ASSERT( file_name );
+    }
 
     template <typename DeviceHandle>
     explicit native_writer( DeviceHandle const handle )
         :
-        libtiff_image
-        (
-            handle,
-            NULL,
-            &input_device<DeviceHandle>::write,
-            NULL,
-            NULL
-        ),
+        device_handle_    ( reinterpret_cast<thandle_t>( handle ) ),
+        p_open_device_    ( &open_device_writer<DeviceHandle>     ),
+        number_of_threads_( 0                                     ),
+        overview_levels_  ( 0                                     ),
+        streamed_height_  ( 0                                     ),
+        next_row_         ( 0                                     )
+    {}
+
+public: /// \ingroup Configuration
+    /// Switches write_default() to tiled output (the TIFF specification
+    /// requires tile dimensions to be multiples of 16). Zero dimensions select
+    /// the default, stripped, output.
+    void set_tile_dimensions( point2<uint32> const & tile_dimensions )
+    {
+        BOOST_ASSERT_MSG( ( tile_dimensions.x % 16 == 0 ) && ( tile_dimensions.y % 16 == 0 ), "TIFF tile dimensions must be multiples of 16." );
+        options_.tile_dimensions = tile_dimensions;
+    }
+
+    /// Compression and layout settings used by write_default() (for every
+    /// directory it writes).
+    void                        set_options( tiff_writer_options const & options ) { options_ = options; }
+    tiff_writer_options const &     options(                                     ) const { return options_; }
+
+    /// Maximum number of threads used for compressing tiles (zero selects the
+    /// number of available CPUs).
+    void set_number_of_threads( unsigned int const number_of_threads ) { number_of_threads_ = number_of_threads; }
+
+    /// Switches write_default() to the Cloud Optimized GeoTIFF (COG) layout:
+    /// tiled (512x512 unless specified otherwise), with up to the specified
+    /// number of overview (2x2 box filtered) directories and with all IFDs
+    /// placed ahead of the tile data, which is in turn stored from the
+    /// smallest overview to the full resolution image. Zero disables it.
+    /// Requires LibTIFF 4.1 (deferred strile array writing) and a readable
+    /// target.
+    /// As the smallest overview is written first all the overview levels are
+    /// held in memory at the same time, i.e. up to an additional third of the
+    /// size of the full resolution image.
+    void set_overview_levels( unsigned int const overview_levels ) { overview_levels_ = overview_levels; }
+
+public:
+    /// Creates the file (a classic TIFF unless tiff_writer_options::file_format
+    /// selects BigTIFF) on first access. Configuring the output through the
+    /// LibTIFF object is meant for write(): write_default() and begin() create
+    /// and configure the file themselves.
+    TIFF & lib_object()
+    {
+        if ( !created() )
+            create( options_.file_format == tiff_writer_options::big_tiff );
+        return libtiff_image::lib_object();
+    }
+
+    TIFF & lib_object() const { return libtiff_image::lib_object(); }
 
     void write_default( detail::tiff_writer_view_data_t const & view )
     {
-        full_format_t::format_bitfield const format_bits( view.format_.bits );
+        create( use_big_tiff( view.format_, view.dimensions_, view.number_of_planes_ ) );
+
+        if ( overview_levels_ )
+        {
+            write_cloud_optimized( view );
+            return;
+        }
+
+        set_image_fields( view.format_, view.dimensions_, options_.tile_dimensions );
+        write( view );
+    }
+
+    void write( detail::tiff_writer_view_data_t const & view )
+    {
+        if ( !created() )
+            create( use_big_tiff( view.format_, view.dimensions_, view.number_of_planes_ ) );
+
+        cumulative_result result;
+
+        if ( ::TIFFIsTiled( &lib_object() ) )
+        {
+            detail::tiff_tile_writer
+            (
+                lib_object(),
+                detail::tiff_raster_t( view ),
+                cached_format_size( view.format_.number ),
+                number_of_threads_ ? number_of_threads_ : detail::hardware_concurrency()
+            ).write( result );
+            result.throw_if_error();
+            return;
+        }
+
+        write_scanlines( view, 0, result );
+        result.throw_if_error();
+    }
+
+public: /// \ingroup Streaming (band by band) output
+    // Implementation note:
+    //   Streamed output is always stripped (tiles and overviews would need
+    // rows the caller has not produced yet) and goes through
+    // TIFFWriteScanline(). With separate planes each band is written plane by
+    // plane so, as LibTIFF cannot append to an already written strip, bands
+    // (except the last one) have to consist of whole strips (see
+    // band_alignment()).
+
+    /// Creates the file and writes the image header for an image of the given
+    /// dimensions and format. The rows are then passed with write_rows().
+    void begin( point2<uint32> const & dimensions, full_format_t const & format )
+    {
+        detail::io_error_if
+        (
+            overview_levels_ || options_.tile_dimensions.x || options_.tile_dimensions.y,
+            "Streamed TIFF output supports only the stripped layout."
+        );
+
+        full_format_t::format_bitfield const format_bits( format.bits );
+        unsigned int const number_of_planes( ( format_bits.planar_configuration == PLANARCONFIG_SEPARATE ) ? format_bits.samples_per_pixel : 1 );
+        create( use_big_tiff( format, dimensions, number_of_planes ) );
+
+        set_image_fields( format, dimensions, options_.tile_dimensions );
+        if ( !options_.rows_per_strip )
+            set_field( TIFFTAG_ROWSPERSTRIP, ::TIFFDefaultStripSize( &lib_object(), 0 ) );
+
+        streamed_height_ = dimensions.y;
+        next_row_        = 0;
+    }
+
+    /// The number of rows the height of each (but the last) band passed to
+    /// write_rows() has to be a multiple of.
+    unsigned int band_alignment() const
+    {
+        uint16 planar_configuration( PLANARCONFIG_CONTIG );
+        uint32 rows_per_strip      ( 1                   );
+        BOOST_VERIFY( ::TIFFGetFieldDefaulted( &lib_object(), TIFFTAG_PLANARCONFIG, &planar_configuration ) );
+        BOOST_VERIFY( ::TIFFGetFieldDefaulted( &lib_object(), TIFFTAG_ROWSPERSTRIP, &rows_per_strip       ) );
+        return ( planar_configuration == PLANARCONFIG_SEPARATE ) ? rows_per_strip : 1;
+    }
+
+    /// Writes the next band of rows (of the full image width).
+    void write_rows( detail::tiff_writer_view_data_t const & band )
+    {
+        // Planar images are written plane by plane, strip by strip, so a band
+        // ending mid-strip would leave the rest of the strip unwritten.
+        detail::io_error_if( next_row_ + band.dimensions_.y > streamed_height_, "More rows written than the streamed TIFF image has." );
+        detail::io_error_if
+        (
+            ( next_row_ + band.dimensions_.y != streamed_height_ ) && ( band.dimensions_.y % band_alignment() != 0 ),
+            "Bands of planar images have to consist of whole strips."
+        );
+
+        cumulative_result result;
+        write_scanlines( band, next_row_, result );
+        next_row_ += band.dimensions_.y;
+        result.throw_if_error();
+    }
+
+    /// Flushes the remaining data and the directory.
+    void finish()
+    {
+        detail::io_error_if( next_row_ != streamed_height_, "Not all rows of the streamed TIFF image were written." );
+        detail::io_error_if_not( ::TIFFFlush( &lib_object() ), "Error writing TIFF file" );
+    }
+
+private:
+    void create( bool const big_tiff )
+    {
+        // A writer writes a single image (file).
+        detail::io_error_if( created(), "The TIFF file has already been created." );
+
+        char const * const access_mode( big_tiff ? "w8" : "w" );
+        attach
+        (
+            p_open_device_
+                ? p_open_device_( device_handle_, access_mode )
+                : ::TIFFOpen( file_name_.c_str(), access_mode )
+        );
+    }
+
+    void write_scanlines( detail::tiff_view_data_t const & view, uint32 const first_row, cumulative_result & result )
+    {
+        for ( unsigned int plane( 0 ); plane < view.number_of_planes_; ++plane )
+        {
+            unsigned char * buf( view.plane_buffers_[ plane ] );
+
+            uint32       row       ( first_row                      );
+            uint32 const target_row( first_row + view.dimensions_.y );
+            while ( row < target_row )
+            {
+                result.accumulate_greater( ::TIFFWriteScanline( &lib_object(), buf, row++, static_cast<tsample_t>( plane ) ), 0 );
+                buf += view.stride_;
+            }
+        }
+    }
+
+    template <typename DeviceHandle>
+    static TIFF * open_device_writer( thandle_t const handle, char const * const access_mode )
+    {
+        return open_device
+        (
+            reinterpret_cast<DeviceHandle>( handle ),
+            &detail::no_read_proc,
+            &detail::write<DeviceHandle>,
+            &detail::memory_sink_map_proc,
+            &detail::memory_unmap_proc,
+            access_mode
+        );
+    }
+
+    bool use_big_tiff( full_format_t const & format, point2<uint32> const & dimensions, unsigned int const number_of_planes ) const
+    {
+        switch ( options_.file_format )
+        {
+            case tiff_writer_options::classic_tiff: return false;
+            case tiff_writer_options::big_tiff    : return true ;
+            default: break;
+        }
+
+        // A conservative estimate: the uncompressed size, plus the overviews
+        // and a margin for codecs expanding incompressible data and for the
+        // directories and their strip/tile offset arrays.
+        uint64_t estimated_size
+        (
+            uint64_t( dimensions.x ) * dimensions.y *
+            cached_format_size( format.number ) * number_of_planes
+        );
+        if ( overview_levels_ )
+            estimated_size += estimated_size / 3;
+        if ( options_.compression != tiff_writer_options::none )
+            estimated_size += estimated_size / 64;
+        estimated_size += 16 * 1024 * 1024;
+
+        return estimated_size > 0xFFFFFFFFU;
+    }
+
+    void set_image_fields( full_format_t const & format, point2<uint32> const & dimensions, point2<uint32> const & tile_dimensions )
+    {
+        full_format_t::format_bitfield const format_bits( format.bits );
         //BOOST_ASSERT( ( format_bits.planar_configuration == PLANARCONFIG_CONTIG ) && "Add planar support..." );
 
-        set_field( TIFFTAG_IMAGEWIDTH     , view.dimensions_.x               );
-        set_field( TIFFTAG_IMAGELENGTH    , view.dimensions_.y               );
+        set_field( TIFFTAG_IMAGEWIDTH     , dimensions.x                     );
+        set_field( TIFFTAG_IMAGELENGTH    , dimensions.y                     );
         set_field( TIFFTAG_BITSPERSAMPLE  , format_bits.bits_per_sample      );
         set_field( TIFFTAG_SAMPLESPERPIXEL, format_bits.samples_per_pixel    );
         set_field( TIFFTAG_PLANARCONFIG   , format_bits.planar_configuration );
@@ -99,30 +871,77 @@ public:
             set_field( TIFFTAG_EXTRASAMPLES, 1, &type );
         }
 
-        write( view );
+        if ( tile_dimensions.x && tile_dimensions.y )
+        {
+            set_field( TIFFTAG_TILEWIDTH , tile_dimensions.x );
+            set_field( TIFFTAG_TILELENGTH, tile_dimensions.y );
+        }
+        else
+        if ( options_.rows_per_strip )
+        {
+            set_field( TIFFTAG_ROWSPERSTRIP, options_.rows_per_strip );
+        }
+
+        // The predictor and level 'pseudo tags' only exist after the codec
+        // has been selected.
+        set_field( TIFFTAG_COMPRESSION, options_.compression );
+        if ( options_.predictor != tiff_writer_options::no_predictor )
+            set_field( TIFFTAG_PREDICTOR, options_.predictor );
+        ttag_t const level_tag( detail::tiff_compression_level_tag( options_.compression ) );
+        if ( level_tag && ( options_.level >= 0 ) )
+            set_field( level_tag, options_.level );
     }
 
-    void write( detail::tiff_writer_view_data_t const & view )
+    void write_cloud_optimized( detail::tiff_writer_view_data_t const & view )
     {
+    #if TIFFLIB_VERSION >= 20191103
+        // (the default must not stick to the options used by later writes)
+        point2<uint32> const tile_dimensions
+        (
+            ( options_.tile_dimensions.x && options_.tile_dimensions.y ) ? options_.tile_dimensions : point2<uint32>( 512, 512 )
+        );
+
+        detail::tiff_raster_t         const full_resolution( view );
+        detail::tiff_overview_pyramid const overviews( full_resolution, view.format_.bits, overview_levels_, tile_dimensions );
+
         cumulative_result result;
 
-        for ( unsigned int plane( 0 ); plane < view.number_of_planes_; ++plane )
+        // Implementation note:
+        //   All the directories are written first, with their tile offset and
+        // byte count arrays reserved (deferred), so that they end up at the
+        // beginning of the file. The tiles are then appended level by level
+        // (smallest first) and the arrays are patched in place.
+        for ( unsigned int level( 0 ); level <= overviews.levels(); ++level )
         {
-            unsigned char * buf( view.plane_buffers_[ plane ] );
-
-            unsigned int       row       ( 0                  );
-            unsigned int const target_row( view.dimensions_.y );
-            while ( row < target_row )
-            {
-                result.accumulate_greater( ::TIFFWriteScanline( &lib_object(), buf, row++, static_cast<tsample_t>( plane ) ), 0 );
-                buf += view.stride_;
-            }
+            set_image_fields( view.format_, level ? overviews.level( level ).dimensions : full_resolution.dimensions, tile_dimensions );
+            set_field( TIFFTAG_SUBFILETYPE, level ? FILETYPE_REDUCEDIMAGE : 0 );
+            result.accumulate( ::TIFFDeferStrileArrayWriting( &lib_object()                                 ) != 0 );
+            result.accumulate( ::TIFFWriteCheck             ( &lib_object(), true, "write_cloud_optimized" ) != 0 );
+            result.accumulate( ::TIFFWriteDirectory         ( &lib_object()                                 ) != 0 );
         }
+        result.throw_if_error();
 
+        unsigned int const number_of_threads( number_of_threads_ ? number_of_threads_ : detail::hardware_concurrency() );
+        for ( unsigned int level( overviews.levels() + 1 ); level-- != 0; )
+        {
+            result.accumulate( ::TIFFSetDirectory( &lib_object(), static_cast<uint16>( level ) ) != 0 );
+            result.throw_if_error();
+            detail::tiff_tile_writer
+            (
+                lib_object(),
+                level ? overviews.level( level ) : full_resolution,
+                cached_format_size( view.format_.number ),
+                number_of_threads
+            ).write( result );
+            result.accumulate( ::TIFFForceStrileArrayWriting( &lib_object() ) != 0 );
+        }
         result.throw_if_error();
+    #else
+        ignore_unused_variable_warning( view );
+        detail::io_error( "Cloud optimized TIFF output requires LibTIFF 4.1 or newer." );
+    #endif // TIFFLIB_VERSION
     }
 
-private:
     template <typename T>
     void set_field( ttag_t const tag, T value )
     {
@@ -138,6 +957,18 @@ private:
     {
         BOOST_VERIFY( ::TIFFSetField( &lib_object(), tag, value1, value2 ) );
     }
+
+private:
+    std::string         file_name_        ;
+    thandle_t           device_handle_    ;
+    TIFF *           (* p_open_device_    )( thandle_t, char const * access_mode );
+
+    tiff_writer_options options_          ;
+    unsigned int        number_of_threads_;
+    unsigned int        overview_levels_  ;
+
+    uint32              streamed_height_  ;
+    uint32              next_row_         ;
 }; // class libtiff_image::native_writer
 
 //------------------------------------------------------------------------------
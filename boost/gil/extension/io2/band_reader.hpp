@@ -0,0 +1,147 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file band_reader.hpp
+/// ---------------------
+///
+/// Bounded memory, band by band, reading through any backend reader.
+///
+/// Copyright (c) GIL.IO2 contributors 2026.
+///
+///  Use, modification and distribution is subject to the
+///  Boost Software License, Version 1.0.
+///  (See accompanying file LICENSE_1_0.txt or copy at
+///  http://www.boost.org/LICENSE_1_0.txt)
+///
+/// For more information, see http://www.boost.org
+///
+////////////////////////////////////////////////////////////////////////////////
+//------------------------------------------------------------------------------
+#ifndef band_reader_hpp__489964ED_AC38_4858_91EC_9D8E3B3BB7F6
+#define band_reader_hpp__489964ED_AC38_4858_91EC_9D8E3B3BB7F6
+#pragma once
+//------------------------------------------------------------------------------
+#include "boost/gil/extension/io2/backends/detail/reader.hpp"
+
+#include "boost/gil/image.hpp"
+#include "boost/gil/image_view_factory.hpp"
+
+#include <boost/assert.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <algorithm>
+//------------------------------------------------------------------------------
+namespace boost
+{
+//------------------------------------------------------------------------------
+namespace gil
+{
+//------------------------------------------------------------------------------
+namespace io
+{
+//------------------------------------------------------------------------------
+namespace detail
+{
+//------------------------------------------------------------------------------
+
+template <typename Offset>
+Offset row_offset( unsigned int const row, Offset const * ) { return Offset( row ); }
+
+template <typename T>
+point2<T> row_offset( unsigned int const row, point2<T> const * ) { return point2<T>( 0, row ); }
+
+//------------------------------------------------------------------------------
+} // namespace detail
+//------------------------------------------------------------------------------
+
+
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \class band_reader
+///
+/// \brief Reads an image as a sequence of (full width) bands of up to
+/// band_height rows converted to the pixel type of Image, holding only a
+/// single band in memory.
+///
+/// Usage:
+///     band_reader<reader_t, rgb8_image_t> bands( reader, 64 );
+///     while ( bands.next() )
+///         process( bands.band(), bands.first_row() );
+///
+/// Built on the ROI/offset view support of the backends so that sequential
+/// (forward only) decoders (LibJPEG, LibPNG) simply keep decoding from where
+/// the previous band stopped. Each band view stays valid only until the next
+/// call to next().
+///
+/// Limitations: interlaced (Adam7) PNG images cannot be read in bands (every
+/// pass spans the whole image so the decoder cannot continue after the first
+/// band) - next() reports an io_error for the second band of such an image.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+template <class Reader, class Image>
+class band_reader : noncopyable
+{
+public:
+    typedef typename Image::view_t view_t;
+
+public:
+    band_reader( Reader const & reader, unsigned int const band_height, unsigned int const alignment = sizeof( void * ) )
+        :
+        reader_     ( reader                                                                            ),
+        band_image_ ( typename Image::point_t( reader.dimensions().x, band_height ), uninitialized_t(), alignment ),
+        band_height_( band_height                                                                       ),
+        first_row_  ( 0                                                                                 ),
+        next_row_   ( 0                                                                                 )
+    {
+        BOOST_ASSERT( band_height );
+    }
+
+    /// Decodes the next band. Returns false (leaving the previous band in
+    /// place) when the whole image has already been read.
+    bool next()
+    {
+        unsigned int const image_height( reader_.dimensions().y );
+        if ( next_row_ >= image_height )
+            return false;
+
+        unsigned int const rows( std::min( band_height_, image_height - next_row_ ) );
+        band_ = subimage_view( view( band_image_ ), 0, 0, band_image_.dimensions().x, rows );
+
+        typedef typename Reader::offset_t offset_t;
+        reader_.copy_to
+        (
+            Reader::offset_view( band_, detail::row_offset( next_row_, static_cast<offset_t const *>( 0 ) ) ),
+            assert_dimensions_match(),
+            synchronize_formats    ()
+        );
+
+        first_row_  = next_row_;
+        next_row_  += rows;
+        return true;
+    }
+
+    /// The most recently decoded band (the last one may be shorter than
+    /// band_height).
+    view_t const & band     () const { return band_     ; }
+    /// The image row that the first row of band() corresponds to.
+    unsigned int   first_row() const { return first_row_; }
+
+    bool done() const { return next_row_ >= reader_.dimensions().y; }
+
+private:
+    Reader       const & reader_     ;
+    Image                band_image_ ;
+    view_t               band_       ;
+    unsigned int   const band_height_;
+    unsigned int         first_row_  ;
+    unsigned int         next_row_   ;
+}; // class band_reader
+
+//------------------------------------------------------------------------------
+} // namespace io
+//------------------------------------------------------------------------------
+} // namespace gil
+//------------------------------------------------------------------------------
+} // namespace boost
+//------------------------------------------------------------------------------
+#endif // band_reader_hpp
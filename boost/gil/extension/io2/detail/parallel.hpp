@@ -0,0 +1,236 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file parallel.hpp
+/// ------------------
+///
+/// Minimal fork-join and locking helpers for backends that can split work
+/// across threads.
+///
+/// Copyright (c) GIL.IO2 contributors 2026.
+///
+///  Use, modification and distribution is subject to the
+///  Boost Software License, Version 1.0.
+///  (See accompanying file LICENSE_1_0.txt or copy at
+///  http://www.boost.org/LICENSE_1_0.txt)
+///
+/// For more information, see http://www.boost.org
+///
+////////////////////////////////////////////////////////////////////////////////
+//------------------------------------------------------------------------------
+#ifndef parallel_hpp__8B2F67D8_D3E3_4825_9870_536583C05A7E
+#define parallel_hpp__8B2F67D8_D3E3_4825_9870_536583C05A7E
+#pragma once
+//------------------------------------------------------------------------------
+#include <boost/assert.hpp>
+#include <boost/config.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <algorithm>
+
+#ifdef _WIN32
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include "windows.h"
+#else
+    #include "pthread.h"
+    #include "unistd.h"
+#endif // _WIN32
+//------------------------------------------------------------------------------
+namespace boost
+{
+//------------------------------------------------------------------------------
+namespace gil
+{
+//------------------------------------------------------------------------------
+namespace io
+{
+//------------------------------------------------------------------------------
+namespace detail
+{
+//------------------------------------------------------------------------------
+
+BOOST_STATIC_CONSTANT( unsigned int, max_worker_threads = 64 );
+
+inline unsigned int hardware_concurrency()
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    ::GetSystemInfo( &info );
+    long const cpus( info.dwNumberOfProcessors );
+#else
+    long const cpus( ::sysconf( _SC_NPROCESSORS_ONLN ) );
+#endif // _WIN32
+    return static_cast<unsigned int>( std::max( 1L, std::min<long>( cpus, max_worker_threads ) ) );
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \class parallel_for_t
+/// \internal
+/// \brief Invokes functor( item, worker ) for every item in [0, number_of_items)
+/// using up to number_of_threads threads (the calling thread included).
+///
+/// Items are handed out dynamically (in increasing order) so uneven work
+/// (e.g. tiles of varying compressibility) is balanced. The worker index is
+/// stable for the duration of the call so it can be used to select per-worker
+/// scratch state. The functor must not throw (errors should be accumulated
+/// and inspected after the call).
+///
+////////////////////////////////////////////////////////////////////////////////
+
+template <class Functor>
+class parallel_for_t : noncopyable
+{
+public:
+    parallel_for_t( unsigned int const number_of_items, Functor & functor )
+        :
+        functor_        ( functor         ),
+        number_of_items_( number_of_items ),
+        next_item_      ( 0               )
+    {}
+
+    void operator()( unsigned int const number_of_threads )
+    {
+        unsigned int const workers( std::max( 1U, std::min( std::min( number_of_threads, number_of_items_ ), +max_worker_threads ) ) );
+        worker_context_t contexts[ max_worker_threads ];
+    #ifdef _WIN32
+        HANDLE    threads[ max_worker_threads ];
+    #else
+        pthread_t threads[ max_worker_threads ];
+    #endif // _WIN32
+        bool launched[ max_worker_threads ];
+
+        for ( unsigned int worker( 1 ); worker < workers; ++worker )
+        {
+            contexts[ worker ].p_this = this  ;
+            contexts[ worker ].worker = worker;
+        #ifdef _WIN32
+            threads [ worker ] = ::CreateThread( NULL, 0, &thread_entry, &contexts[ worker ], 0, NULL );
+            launched[ worker ] = threads[ worker ] != NULL;
+        #else
+            launched[ worker ] = ::pthread_create( &threads[ worker ], NULL, &thread_entry, &contexts[ worker ] ) == 0;
+        #endif // _WIN32
+        }
+
+        // The calling thread is worker 0 (and picks up any work left over by
+        // threads that failed to launch).
+        run( 0 );
+
+        for ( unsigned int worker( 1 ); worker < workers; ++worker )
+        {
+            if ( !launched[ worker ] )
+                continue;
+        #ifdef _WIN32
+            ::WaitForSingleObject( threads[ worker ], INFINITE );
+            ::CloseHandle( threads[ worker ] );
+        #else
+            BOOST_VERIFY( ::pthread_join( threads[ worker ], NULL ) == 0 );
+        #endif // _WIN32
+        }
+    }
+
+private:
+    struct worker_context_t
+    {
+        parallel_for_t * p_this;
+        unsigned int     worker;
+    };
+
+    void run( unsigned int const worker )
+    {
+        for ( ; ; )
+        {
+            unsigned int const item( fetch_next_item() );
+            if ( item >= number_of_items_ )
+                break;
+            functor_( item, worker );
+        }
+    }
+
+    unsigned int fetch_next_item()
+    {
+    #ifdef _WIN32
+        return static_cast<unsigned int>( ::InterlockedExchangeAdd( &next_item_, 1 ) );
+    #else
+        return __sync_fetch_and_add( &next_item_, 1U );
+    #endif // _WIN32
+    }
+
+#ifdef _WIN32
+    static DWORD WINAPI thread_entry( LPVOID const p_context )
+#else
+    static void *       thread_entry( void * const p_context )
+#endif // _WIN32
+    {
+        worker_context_t const & context( *static_cast<worker_context_t const *>( p_context ) );
+        context.p_this->run( context.worker );
+        return 0;
+    }
+
+private:
+    Functor            & functor_        ;
+    unsigned int   const number_of_items_;
+#ifdef _WIN32
+    LONG volatile        next_item_      ;
+#else
+    unsigned int volatile next_item_     ;
+#endif // _WIN32
+}; // class parallel_for_t
+
+
+class mutex : noncopyable
+{
+public:
+#ifdef _WIN32
+     mutex() { ::InitializeCriticalSection( &mutex_ ); }
+    ~mutex() { ::DeleteCriticalSection    ( &mutex_ ); }
+
+    void lock  () { ::EnterCriticalSection( &mutex_ ); }
+    void unlock() { ::LeaveCriticalSection( &mutex_ ); }
+#else
+     mutex() { BOOST_VERIFY( ::pthread_mutex_init   ( &mutex_, NULL ) == 0 ); }
+    ~mutex() { BOOST_VERIFY( ::pthread_mutex_destroy( &mutex_       ) == 0 ); }
+
+    void lock  () { BOOST_VERIFY( ::pthread_mutex_lock  ( &mutex_ ) == 0 ); }
+    void unlock() { BOOST_VERIFY( ::pthread_mutex_unlock( &mutex_ ) == 0 ); }
+#endif // _WIN32
+
+    class scoped_lock : noncopyable
+    {
+    public:
+        explicit scoped_lock( mutex & mutex ) : mutex_( mutex ) { mutex_.lock  (); }
+                ~scoped_lock(               )                   { mutex_.unlock(); }
+    private:
+        mutex & mutex_;
+    }; // class scoped_lock
+
+private:
+#ifdef _WIN32
+    CRITICAL_SECTION mutex_;
+#else
+    pthread_mutex_t  mutex_;
+#endif // _WIN32
+}; // class mutex
+
+
+template <class Functor>
+void parallel_for( unsigned int const number_of_items, unsigned int const number_of_threads, Functor & functor )
+{
+    parallel_for_t<Functor>( number_of_items, functor )( number_of_threads );
+}
+
+//------------------------------------------------------------------------------
+} // namespace detail
+//------------------------------------------------------------------------------
+} // namespace io
+//------------------------------------------------------------------------------
+} // namespace gil
+//------------------------------------------------------------------------------
+} // namespace boost
+//------------------------------------------------------------------------------
+#endif // parallel_hpp
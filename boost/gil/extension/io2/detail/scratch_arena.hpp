@@ -0,0 +1,350 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file scratch_arena.hpp
+/// -----------------------
+///
+/// Pluggable temporary (scratch) memory provider for GIL.IO2 backends.
+///
+/// Copyright (c) GIL.IO2 contributors 2026.
+///
+///  Use, modification and distribution is subject to the
+///  Boost Software License, Version 1.0.
+///  (See accompanying file LICENSE_1_0.txt or copy at
+///  http://www.boost.org/LICENSE_1_0.txt)
+///
+/// For more information, see http://www.boost.org
+///
+////////////////////////////////////////////////////////////////////////////////
+//------------------------------------------------------------------------------
+#ifndef scratch_arena_hpp__C22303E2_04AA_4AB4_98DC_F7FF49E3907C
+#define scratch_arena_hpp__C22303E2_04AA_4AB4_98DC_F7FF49E3907C
+#pragma once
+//------------------------------------------------------------------------------
+#include <boost/assert.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/throw_exception.hpp>
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include "windows.h"
+#else
+    #include "pthread.h"
+#endif // _WIN32
+//------------------------------------------------------------------------------
+namespace boost
+{
+//------------------------------------------------------------------------------
+namespace gil
+{
+//------------------------------------------------------------------------------
+namespace io
+{
+//------------------------------------------------------------------------------
+
+#ifndef BOOST_GIL_THREAD_LOCAL
+    #ifdef _MSC_VER
+        #define BOOST_GIL_THREAD_LOCAL __declspec( thread )
+    #else
+        #define BOOST_GIL_THREAD_LOCAL __thread
+    #endif
+#endif // BOOST_GIL_THREAD_LOCAL
+
+
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \class scratch_arena
+///
+/// \brief Interface for providers of temporary memory used by backends while
+/// reading or writing a single image (scanline, row and tile buffers).
+///
+/// Allocations are never individually freed: all memory handed out by
+/// allocate() is reclaimed at once by reset(), which the backends invoke when
+/// the outermost scratch_buffer (i.e. the processing of an image) ends.
+/// allocate() reports failure by throwing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+class scratch_arena
+{
+public:
+    virtual void * allocate( std::size_t size, std::size_t alignment ) = 0;
+    virtual void   reset   (                                         ) = 0;
+
+protected:
+    ~scratch_arena() {}
+}; // class scratch_arena
+
+
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \class thread_bump_arena
+///
+/// \brief The default, per-thread, bump-pointer scratch_arena.
+///
+/// Serves allocations from a single contiguous chunk. Requests that do not fit
+/// are served from the heap and the chunk is grown (to the high watermark) on
+/// the next reset() so that, once warmed up, no heap allocations are made.
+/// The chunk is retained between images; release_memory() returns it to the
+/// heap earlier, otherwise it is freed when its thread exits.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+class thread_bump_arena : public scratch_arena
+{
+public:
+    static thread_bump_arena & instance()
+    {
+        static thread_bump_arena singleton;
+        return singleton;
+    }
+
+    void * allocate( std::size_t const size, std::size_t const alignment )
+    {
+        BOOST_ASSERT( alignment && !( alignment & ( alignment - 1 ) ) );
+        state_t & state( this_thread_state() );
+
+        std::size_t const aligned_position( ( state.used + alignment - 1 ) & ~( alignment - 1 ) );
+        state.requested += size + alignment - 1;
+        if ( aligned_position + size <= state.capacity )
+        {
+            state.used = aligned_position + size;
+            return state.p_chunk + aligned_position;
+        }
+
+        // Overflow blocks are chained through a header placed in front of the
+        // (aligned) payload.
+        std::size_t   const header_size( ( sizeof( overflow_header_t ) + alignment - 1 ) & ~( alignment - 1 ) );
+        unsigned char * const p_block    ( static_cast<unsigned char *>( std::malloc( header_size + size + alignment - 1 ) ) );
+        if ( !p_block )
+            throw_exception( std::bad_alloc() );
+        overflow_header_t & header( *reinterpret_cast<overflow_header_t *>( p_block ) );
+        header.p_next     = state.p_overflow;
+        state.p_overflow  = &header;
+        std::size_t const payload( ( reinterpret_cast<std::size_t>( p_block ) + header_size + alignment - 1 ) & ~( alignment - 1 ) );
+        return reinterpret_cast<void *>( payload );
+    }
+
+    void reset()
+    {
+        state_t & state( this_thread_state() );
+        bool const overflowed( state.p_overflow != 0 );
+        free_overflow( state );
+        if ( overflowed && ( state.requested > state.capacity ) )
+        {
+            std::free( state.p_chunk );
+            state.p_chunk  = static_cast<unsigned char *>( std::malloc( state.requested ) );
+            state.capacity = state.p_chunk ? state.requested : 0;
+            register_thread_exit_cleanup( state );
+        }
+        state.used      = 0;
+        state.requested = 0;
+    }
+
+    static void release_memory()
+    {
+        state_t & state( this_thread_state() );
+        BOOST_ASSERT_MSG( !state.used, "Scratch memory still in use." );
+        free_overflow( state );
+        std::free( state.p_chunk );
+        state.p_chunk   = 0;
+        state.capacity  = 0;
+        state.used      = 0;
+        state.requested = 0;
+    }
+
+private:
+    struct overflow_header_t { overflow_header_t * p_next; };
+
+    // Implementation note:
+    //   Only POD types can be placed in (compiler provided) thread local
+    // storage so the per-thread state is kept separate from the (stateless)
+    // arena object itself.
+    struct state_t
+    {
+        unsigned char     * p_chunk   ;
+        std::size_t         capacity  ;
+        std::size_t         used      ;
+        std::size_t         requested ;
+        overflow_header_t * p_overflow;
+    };
+
+    static state_t & this_thread_state()
+    {
+        static BOOST_GIL_THREAD_LOCAL state_t state = { 0, 0, 0, 0, 0 };
+        return state;
+    }
+
+    static void free_overflow( state_t & state )
+    {
+        while ( state.p_overflow )
+        {
+            overflow_header_t * const p_next( state.p_overflow->p_next );
+            std::free( state.p_overflow );
+            state.p_overflow = p_next;
+        }
+    }
+
+    // Implementation note:
+    //   Compiler provided thread local storage has no destructors so the
+    // chunk is additionally registered with the OS provided thread local
+    // storage (a pthread key or a fiber local storage slot) whose destructor
+    // frees it when the thread exits (worker threads, e.g. those of
+    // detail::parallel_for(), would otherwise each leak a chunk).
+    static void register_thread_exit_cleanup( state_t & state )
+    {
+    #ifdef _WIN32
+        static LONG volatile slot = FLS_OUT_OF_INDEXES;
+        if ( slot == FLS_OUT_OF_INDEXES )
+        {
+            DWORD const new_slot( ::FlsAlloc( &thread_exit_cleanup ) );
+            if ( ::InterlockedCompareExchange( &slot, new_slot, FLS_OUT_OF_INDEXES ) != FLS_OUT_OF_INDEXES )
+                ::FlsFree( new_slot );
+        }
+        if ( slot != FLS_OUT_OF_INDEXES )
+            BOOST_VERIFY( ::FlsSetValue( slot, &state ) );
+    #else
+        static pthread_once_t once = PTHREAD_ONCE_INIT;
+        BOOST_VERIFY( ::pthread_once( &once, &create_thread_exit_key ) == 0 );
+        BOOST_VERIFY( ::pthread_setspecific( thread_exit_key(), &state ) == 0 );
+    #endif // _WIN32
+    }
+
+#ifdef _WIN32
+    static void WINAPI thread_exit_cleanup( void * const p_state )
+#else
+    static pthread_key_t & thread_exit_key()
+    {
+        static pthread_key_t key;
+        return key;
+    }
+
+    static void create_thread_exit_key() { BOOST_VERIFY( ::pthread_key_create( &thread_exit_key(), &thread_exit_cleanup ) == 0 ); }
+
+    static void thread_exit_cleanup( void * const p_state )
+#endif // _WIN32
+    {
+        if ( !p_state )
+            return;
+        state_t & state( *static_cast<state_t *>( p_state ) );
+        free_overflow( state );
+        std::free( state.p_chunk );
+        state.p_chunk  = 0;
+        state.capacity = 0;
+    }
+}; // class thread_bump_arena
+
+
+namespace detail
+{
+//------------------------------------------------------------------------------
+
+struct scratch_arena_state_t
+{
+    scratch_arena * p_arena;
+    unsigned int    depth  ;
+};
+
+inline scratch_arena_state_t & this_thread_scratch_arena_state()
+{
+    static BOOST_GIL_THREAD_LOCAL scratch_arena_state_t state = { 0, 0 };
+    return state;
+}
+
+//------------------------------------------------------------------------------
+} // namespace detail
+
+
+/// Returns the scratch_arena used by the calling thread.
+inline scratch_arena & thread_scratch_arena()
+{
+    scratch_arena * const p_arena( detail::this_thread_scratch_arena_state().p_arena );
+    return p_arena ? *p_arena : thread_bump_arena::instance();
+}
+
+/// Installs a custom scratch_arena for the calling thread (null restores the
+/// default thread_bump_arena). Must not be called while an image is being
+/// processed on the same thread.
+inline void set_thread_scratch_arena( scratch_arena * const p_arena )
+{
+    detail::scratch_arena_state_t & state( detail::this_thread_scratch_arena_state() );
+    BOOST_ASSERT_MSG( !state.depth, "Cannot switch scratch arenas while in use." );
+    state.p_arena = p_arena;
+}
+
+
+namespace detail
+{
+//------------------------------------------------------------------------------
+
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \class scratch_buffer
+/// \internal
+/// \brief Scoped array of T allocated from the thread's scratch_arena.
+///
+/// The arena is reset when the outermost (first constructed) scratch_buffer
+/// on a given thread is destroyed. T is expected to be a POD type (elements
+/// are neither constructed nor destroyed).
+///
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+class scratch_buffer : noncopyable
+{
+public:
+    explicit scratch_buffer( std::size_t const size )
+    {
+        scratch_arena_state_t & state( this_thread_scratch_arena_state() );
+        // Increment first so that a throwing allocate() is balanced by the
+        // destructor of an outer buffer (or the explicit decrement below).
+        ++state.depth;
+        try
+        {
+            p_begin_ = static_cast<T *>( thread_scratch_arena().allocate( size * sizeof( T ), alignment ) );
+        }
+        catch ( ... )
+        {
+            release( state );
+            throw;
+        }
+    }
+
+    ~scratch_buffer() { release( this_thread_scratch_arena_state() ); }
+
+    T * get() const { return p_begin_; }
+
+    T & operator[]( std::size_t const index ) const { return p_begin_[ index ]; }
+
+private:
+    static void release( scratch_arena_state_t & state )
+    {
+        BOOST_ASSERT( state.depth );
+        if ( --state.depth == 0 )
+            thread_scratch_arena().reset();
+    }
+
+private:
+    BOOST_STATIC_CONSTANT( std::size_t, alignment = 16 );
+
+    T * p_begin_;
+}; // class scratch_buffer
+
+//------------------------------------------------------------------------------
+} // namespace detail
+//------------------------------------------------------------------------------
+} // namespace io
+//------------------------------------------------------------------------------
+} // namespace gil
+//------------------------------------------------------------------------------
+} // namespace boost
+//------------------------------------------------------------------------------
+#endif // scratch_arena_hpp
@@ -50,7 +50,7 @@ struct device<FILE *> : detail::device_base
         #ifdef BOOST_MSVC
             return /*std*/::_ftelli64( handle );
         #else
-            return /*std*/::ftell64  ( handle );
+            return /*std*/::ftello   ( handle );
         #endif // BOOST_MSVC
     }
 
@@ -72,7 +72,7 @@ struct device<c_file_descriptor_t> : detail::device_base
     #ifdef BOOST_MSVC
         return /*std*/::_telli64( handle );
     #else
-        return /*std*/::tell64  ( handle );
+        return /*std*/::lseek   ( handle, 0, SEEK_CUR ); // 64 bit off_t with _FILE_OFFSET_BITS=64
     #endif // BOOST_MSVC
     }
 
@@ -108,7 +108,7 @@ struct device<c_file_descriptor_t> : detail::device_base
     #ifdef BOOST_MSVC
         return /*std*/::_lseeki64( handle, offset, origin ) != 0;
     #else
-        return /*std*/::lseeko   ( handle, offset, origin ) != 0;
+        return /*std*/::lseek    ( handle, offset, origin ) != 0;
     #endif
     }
 }; // struct device<c_file_descriptor_t>
@@ -0,0 +1,381 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file huge_page_allocator.hpp
+/// -----------------------------
+///
+/// Huge-page and NUMA aware allocator for large gil::image rasters.
+///
+/// Copyright (c) GIL.IO2 contributors 2026.
+///
+///  Use, modification and distribution is subject to the
+///  Boost Software License, Version 1.0.
+///  (See accompanying file LICENSE_1_0.txt or copy at
+///  http://www.boost.org/LICENSE_1_0.txt)
+///
+/// For more information, see http://www.boost.org
+///
+////////////////////////////////////////////////////////////////////////////////
+//------------------------------------------------------------------------------
+#ifndef huge_page_allocator_hpp__860BBFEC_AB8C_4366_83DB_A9C2B7F99F67
+#define huge_page_allocator_hpp__860BBFEC_AB8C_4366_83DB_A9C2B7F99F67
+#pragma once
+//------------------------------------------------------------------------------
+#include "boost/gil/extension/io2/detail/parallel.hpp"
+#include "boost/gil/extension/io2/detail/platform_specifics.hpp"
+
+#include <boost/assert.hpp>
+#include <boost/concept_check.hpp>
+#include <boost/throw_exception.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include "windows.h"
+#else
+    #include "sys/mman.h"
+    #include "unistd.h"
+    #ifdef __linux__
+        #include "linux/mempolicy.h"
+        #include "sys/syscall.h"
+    #endif // __linux__
+#endif // _WIN32
+//------------------------------------------------------------------------------
+namespace boost
+{
+//------------------------------------------------------------------------------
+namespace gil
+{
+//------------------------------------------------------------------------------
+
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \enum numa_placement
+///
+/// \brief Page placement policy applied to huge_page_allocator allocations.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+enum numa_placement
+{
+    numa_default   , ///< OS default (pages are placed on first touch)
+    numa_bind      , ///< pages are restricted to the nodes in the node mask
+    numa_interleave  ///< pages are distributed round-robin across the nodes in the node mask
+};
+
+
+namespace detail
+{
+//------------------------------------------------------------------------------
+
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \class huge_page_allocator_base
+/// \internal
+/// \brief Type independent (non-template) part of huge_page_allocator<>.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+class huge_page_allocator_base
+{
+public:
+    BOOST_STATIC_CONSTANT( std::size_t, huge_page_size = 2 * 1024 * 1024 );
+
+    huge_page_allocator_base
+    (
+        numa_placement const placement           = numa_default,
+        unsigned long  const node_mask           = 0,
+        unsigned int   const first_touch_threads = 0
+    )
+        :
+        placement_          ( placement           ),
+        node_mask_          ( node_mask           ),
+        first_touch_threads_( first_touch_threads )
+    {
+        BOOST_ASSERT_MSG( ( placement == numa_default ) || node_mask, "A node mask is required for bind/interleave placement." );
+    }
+
+    numa_placement placement          () const { return placement_          ; }
+    unsigned long  node_mask          () const { return node_mask_          ; }
+    unsigned int   first_touch_threads() const { return first_touch_threads_; }
+
+    bool operator==( huge_page_allocator_base const & other ) const
+    {
+        return
+            ( placement_           == other.placement_           ) &&
+            ( node_mask_           == other.node_mask_           ) &&
+            ( first_touch_threads_ == other.first_touch_threads_ );
+    }
+    bool operator!=( huge_page_allocator_base const & other ) const { return !( *this == other ); }
+
+protected:
+    void * allocate_bytes( std::size_t const size ) const
+    {
+        // Implementation note:
+        //   Mapping (and rounding up to) whole huge pages for small requests
+        // would waste up to a huge page per allocation for no TLB gain so those
+        // go through the CRT heap. The same (size based) decision is repeated
+        // in deallocate_bytes() so no extra bookkeeping is required.
+        if ( size < huge_page_size )
+        {
+            void * const p_memory( std::malloc( size ) );
+            if ( !p_memory )
+                throw_exception( std::bad_alloc() );
+            return p_memory;
+        }
+
+        std::size_t const mapping_size( round_up_to_huge_page( size ) );
+        unsigned char * const p_memory( static_cast<unsigned char *>( map( mapping_size ) ) );
+        if ( !p_memory )
+            throw_exception( std::bad_alloc() );
+
+        apply_placement( p_memory, mapping_size );
+        if ( first_touch_threads_ )
+            first_touch( p_memory, mapping_size );
+
+        return p_memory;
+    }
+
+    static void deallocate_bytes( void * const p_memory, std::size_t const size )
+    {
+        if ( !p_memory )
+            return;
+        if ( size < huge_page_size )
+            std::free( p_memory );
+        else
+            unmap( p_memory, round_up_to_huge_page( size ) );
+    }
+
+private:
+    static std::size_t round_up_to_huge_page( std::size_t const size )
+    {
+        return ( size + huge_page_size - 1 ) & ~( huge_page_size - 1 );
+    }
+
+#ifdef _WIN32
+    void * map( std::size_t const size ) const
+    {
+        // Large pages require the SeLockMemoryPrivilege and a size that is a
+        // multiple of GetLargePageMinimum(), fallback to regular pages if
+        // either is not satisfied.
+        SIZE_T const large_page_minimum( ::GetLargePageMinimum() );
+        DWORD  const preferred_node    ( preferred_numa_node()   );
+        if ( large_page_minimum && ( size % large_page_minimum == 0 ) )
+        {
+            void * const p_memory( virtual_alloc( size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, preferred_node ) );
+            if ( p_memory )
+                return p_memory;
+        }
+        return virtual_alloc( size, MEM_RESERVE | MEM_COMMIT, preferred_node );
+    }
+
+    static void * virtual_alloc( std::size_t const size, DWORD const allocation_type, DWORD const preferred_node )
+    {
+        return ( preferred_node != NUMA_NO_PREFERRED_NODE )
+            ? ::VirtualAllocExNuma( ::GetCurrentProcess(), NULL, size, allocation_type, PAGE_READWRITE, preferred_node )
+            : ::VirtualAlloc      (                        NULL, size, allocation_type, PAGE_READWRITE                 );
+    }
+
+    static void unmap( void * const p_memory, std::size_t /*size*/ )
+    {
+        BOOST_VERIFY( ::VirtualFree( p_memory, 0, MEM_RELEASE ) );
+    }
+
+    DWORD preferred_numa_node() const
+    {
+        // Windows offers no interleaving policy, only a preferred node (the
+        // lowest one from the mask is used).
+        if ( placement_ == numa_default )
+            return NUMA_NO_PREFERRED_NODE;
+        DWORD node( 0 );
+        while ( !( node_mask_ & ( 1UL << node ) ) )
+            ++node;
+        return node;
+    }
+
+    void apply_placement( void * /*p_memory*/, std::size_t /*size*/ ) const {}
+#else
+    static void * map( std::size_t const size )
+    {
+        int const protection( PROT_READ | PROT_WRITE         );
+        int const flags     ( MAP_PRIVATE | MAP_ANONYMOUS );
+    #ifdef MAP_HUGETLB
+        // Explicit huge pages succeed only if the administrator reserved a
+        // hugetlbfs pool (vm.nr_hugepages)...
+        void * p_memory( ::mmap( NULL, size, protection, flags | MAP_HUGETLB, -1, 0 ) );
+        if ( p_memory != MAP_FAILED )
+            return p_memory;
+    #endif // MAP_HUGETLB
+        // ...otherwise fallback to regular pages with a transparent huge page
+        // hint.
+        void * const p_regular_memory( ::mmap( NULL, size, protection, flags, -1, 0 ) );
+        if ( p_regular_memory == MAP_FAILED )
+            return NULL;
+    #ifdef MADV_HUGEPAGE
+        ::madvise( p_regular_memory, size, MADV_HUGEPAGE );
+    #endif // MADV_HUGEPAGE
+        return p_regular_memory;
+    }
+
+    static void unmap( void * const p_memory, std::size_t const size )
+    {
+        BOOST_VERIFY( ::munmap( p_memory, size ) == 0 );
+    }
+
+    void apply_placement( void * const p_memory, std::size_t const size ) const
+    {
+    #ifdef __linux__
+        if ( placement_ == numa_default )
+            return;
+        // Implementation note:
+        //   mbind() is invoked as a raw syscall to avoid a libnuma link time
+        // dependency. A failure (e.g. a non NUMA kernel) is not fatal as it
+        // only affects performance.
+        int           const mode     ( ( placement_ == numa_bind ) ? MPOL_BIND : MPOL_INTERLEAVE );
+        unsigned long const node_mask( node_mask_                                                );
+        ::syscall( SYS_mbind, p_memory, size, mode, &node_mask, sizeof( node_mask ) * 8, 0 );
+    #else
+        ignore_unused_variable_warning( p_memory );
+        ignore_unused_variable_warning( size     );
+    #endif // __linux__
+    }
+#endif // _WIN32
+
+    // parallel_for() functor: slice i spans [i * slice_size, (i + 1) * slice_size).
+    struct first_touch_slices_t
+    {
+        void operator()( unsigned int const slice, unsigned int /*worker*/ ) const
+        {
+            unsigned char const * const p_end( p_memory + std::min( ( slice + 1 ) * slice_size, size ) );
+            for ( unsigned char volatile * p_page( p_memory + slice * slice_size ); p_page < p_end; p_page += page_size )
+                *p_page = 0;
+        }
+
+        unsigned char * p_memory  ;
+        std::size_t     size      ;
+        std::size_t     slice_size;
+        std::size_t     page_size ;
+    };
+
+    void first_touch( unsigned char * const p_memory, std::size_t const size ) const
+    {
+        // Each worker faults-in a contiguous, huge page aligned, slice so that
+        // (with the default placement) pages land on the node of the thread
+        // that will most likely be processing them.
+        unsigned int const workers
+        (
+            static_cast<unsigned int>( std::min<std::size_t>( std::min( first_touch_threads_, +io::detail::max_worker_threads ), size / huge_page_size ) )
+        );
+        first_touch_slices_t const slices = { p_memory, size, round_up_to_huge_page( size / workers ), system_page_size() };
+        io::detail::parallel_for( static_cast<unsigned int>( ( size + slices.slice_size - 1 ) / slices.slice_size ), workers, slices );
+    }
+
+    static std::size_t system_page_size()
+    {
+    #ifdef _WIN32
+        SYSTEM_INFO info;
+        ::GetSystemInfo( &info );
+        return info.dwPageSize;
+    #else
+        return static_cast<std::size_t>( ::sysconf( _SC_PAGESIZE ) );
+    #endif // _WIN32
+    }
+
+private:
+    numa_placement placement_          ;
+    unsigned long  node_mask_          ;
+    unsigned int   first_touch_threads_;
+}; // class huge_page_allocator_base
+
+//------------------------------------------------------------------------------
+} // namespace detail
+
+
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \class huge_page_allocator
+///
+/// \brief Standard allocator model that backs large allocations with (2MB)
+/// huge pages.
+///
+/// Allocations of at least one huge page are mmap-ed directly: explicit
+/// (MAP_HUGETLB) huge pages are tried first with a fallback to regular pages
+/// marked for transparent huge page promotion (MADV_HUGEPAGE). The pages can
+/// optionally be bound to or interleaved across a set of NUMA nodes and
+/// faulted-in in parallel (first touch) by a number of worker threads.
+/// Smaller allocations fall through to the CRT heap.
+///
+/// Intended as the Alloc parameter of gil::image for (tile) scanning very
+/// large rasters, e.g.:
+/// \code
+/// typedef image<rgb8_pixel_t, false, huge_page_allocator<unsigned char> > raster_t;
+/// raster_t raster( 20000, 20000, 0, huge_page_allocator<unsigned char>( numa_interleave, 0x3, 8 ) );
+/// \endcode
+///
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+class huge_page_allocator : public detail::huge_page_allocator_base
+{
+public:
+    typedef T                 value_type     ;
+    typedef T               * pointer        ;
+    typedef T         const * const_pointer  ;
+    typedef T               & reference      ;
+    typedef T         const & const_reference;
+    typedef std::size_t       size_type      ;
+    typedef std::ptrdiff_t    difference_type;
+
+    template <typename Other>
+    struct rebind { typedef huge_page_allocator<Other> other; };
+
+public:
+    explicit huge_page_allocator
+    (
+        numa_placement const placement           = numa_default,
+        unsigned long  const node_mask           = 0,
+        unsigned int   const first_touch_threads = 0
+    )
+        :
+        detail::huge_page_allocator_base( placement, node_mask, first_touch_threads )
+    {}
+
+    template <typename Other>
+    huge_page_allocator( huge_page_allocator<Other> const & other )
+        :
+        detail::huge_page_allocator_base( other )
+    {}
+
+    pointer allocate( size_type const n, void const * /*hint*/ = 0 ) const
+    {
+        return static_cast<pointer>( allocate_bytes( n * sizeof( T ) ) );
+    }
+
+    void deallocate( pointer const p, size_type const n ) const
+    {
+        deallocate_bytes( p, n * sizeof( T ) );
+    }
+
+    size_type max_size() const { return static_cast<size_type>( -1 ) / sizeof( T ); }
+
+    pointer       address( reference       x ) const { return &x; }
+    const_pointer address( const_reference x ) const { return &x; }
+
+    void construct( pointer const p, const_reference value ) const { new ( p ) T( value ); }
+    void destroy  ( pointer const p                        ) const { p->~T(); ignore_unused_variable_warning( p ); }
+}; // class huge_page_allocator
+
+//------------------------------------------------------------------------------
+} // namespace gil
+//------------------------------------------------------------------------------
+} // namespace boost
+//------------------------------------------------------------------------------
+#endif // huge_page_allocator_hpp
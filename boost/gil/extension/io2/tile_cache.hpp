@@ -0,0 +1,195 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file tile_cache.hpp
+/// --------------------
+///
+/// Thread safe, sharded, LRU cache of decoded image tiles.
+///
+/// Copyright (c) GIL.IO2 contributors 2026.
+///
+///  Use, modification and distribution is subject to the
+///  Boost Software License, Version 1.0.
+///  (See accompanying file LICENSE_1_0.txt or copy at
+///  http://www.boost.org/LICENSE_1_0.txt)
+///
+/// For more information, see http://www.boost.org
+///
+////////////////////////////////////////////////////////////////////////////////
+//------------------------------------------------------------------------------
+#ifndef tile_cache_hpp__313F4F9E_8D06_4061_9F87_606E5D123E1E
+#define tile_cache_hpp__313F4F9E_8D06_4061_9F87_606E5D123E1E
+#pragma once
+//------------------------------------------------------------------------------
+#include "boost/gil/extension/io2/detail/parallel.hpp"
+
+#include <boost/assert.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/smart_ptr/scoped_array.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <list>
+#include <map>
+#include <vector>
+//------------------------------------------------------------------------------
+namespace boost
+{
+//------------------------------------------------------------------------------
+namespace gil
+{
+//------------------------------------------------------------------------------
+namespace io
+{
+//------------------------------------------------------------------------------
+
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \class tile_cache
+///
+/// \brief Memory bounded cache of decoded tiles that can be shared by any
+/// number of readers (and threads).
+///
+/// Tiles are identified by a user chosen source identifier (which has to be
+/// unique for every distinct image source sharing the cache), a page
+/// (directory) and a tile index. The cache is split into independently locked
+/// shards (each with its own LRU list and an equal share of the memory
+/// budget) to reduce contention. Tiles are copied in and out of the cache so
+/// eviction never invalidates data held by readers.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+class tile_cache : noncopyable
+{
+public:
+    struct tile_key_t
+    {
+        uint64_t     source;
+        unsigned int page  ;
+        unsigned int tile  ;
+
+        bool operator<( tile_key_t const & other ) const
+        {
+            if ( source != other.source ) return source < other.source;
+            if ( page   != other.page   ) return page   < other.page  ;
+            return tile < other.tile;
+        }
+    };
+
+public:
+    explicit tile_cache( std::size_t const memory_budget, unsigned int const number_of_shards = 16 )
+        :
+        shards_             ( new shard_t[ number_of_shards ] ),
+        number_of_shards_   ( number_of_shards                ),
+        shard_memory_budget_( memory_budget / number_of_shards )
+    {
+        BOOST_ASSERT( number_of_shards );
+    }
+
+    /// Copies the tile into p_tile and marks it as most recently used. Returns
+    /// false on a miss.
+    bool find( tile_key_t const & key, void * const p_tile, std::size_t const size )
+    {
+        shard_t & shard( shard_for( key ) );
+        detail::mutex::scoped_lock const lock( shard.mutex );
+        index_t::iterator const p_entry( shard.index.find( key ) );
+        if ( p_entry == shard.index.end() )
+            return false;
+        entry_t const & entry( *p_entry->second );
+        BOOST_ASSERT_MSG( entry.data.size() == size, "Tile size mismatch (source identifiers not unique?)." );
+        std::memcpy( p_tile, &entry.data[ 0 ], std::min( size, entry.data.size() ) );
+        shard.entries.splice( shard.entries.begin(), shard.entries, p_entry->second );
+        return true;
+    }
+
+    /// Adds (a copy of) the tile, evicting the least recently used tiles of
+    /// the same shard as required by the memory budget.
+    void insert( tile_key_t const & key, void const * const p_tile, std::size_t const size )
+    {
+        if ( size > shard_memory_budget_ )
+            return;
+
+        // Copy outside of the lock.
+        entry_t entry;
+        entry.key = key;
+        entry.data.assign( static_cast<unsigned char const *>( p_tile ), static_cast<unsigned char const *>( p_tile ) + size );
+
+        shard_t & shard( shard_for( key ) );
+        detail::mutex::scoped_lock const lock( shard.mutex );
+        if ( shard.index.find( key ) != shard.index.end() )
+            return; // inserted by a concurrent reader in the meantime
+
+        shard.entries.push_front( entry_t() );
+        shard.entries.front().key = key;
+        shard.entries.front().data.swap( entry.data );
+        shard.index.insert( index_t::value_type( key, shard.entries.begin() ) );
+        shard.memory_used += size;
+
+        while ( shard.memory_used > shard_memory_budget_ )
+        {
+            entry_t & victim( shard.entries.back() );
+            shard.memory_used -= victim.data.size();
+            shard.index.erase( victim.key );
+            shard.entries.pop_back();
+        }
+    }
+
+    void clear()
+    {
+        for ( unsigned int shard( 0 ); shard < number_of_shards_; ++shard )
+        {
+            detail::mutex::scoped_lock const lock( shards_[ shard ].mutex );
+            shards_[ shard ].entries.clear();
+            shards_[ shard ].index  .clear();
+            shards_[ shard ].memory_used = 0;
+        }
+    }
+
+    std::size_t memory_budget() const { return shard_memory_budget_ * number_of_shards_; }
+
+private:
+    struct entry_t
+    {
+        tile_key_t                      key ;
+        std::vector<unsigned char> data;
+    };
+
+    typedef std::list<entry_t                            > entries_t;
+    typedef std::map <tile_key_t, entries_t::iterator         > index_t  ;
+
+    struct shard_t
+    {
+        shard_t() : memory_used( 0 ) {}
+
+        detail::mutex mutex      ;
+        entries_t     entries    ; // most recently used first
+        index_t       index      ;
+        std::size_t   memory_used;
+    };
+
+    shard_t & shard_for( tile_key_t const & key ) const
+    {
+        uint64_t const hash
+        (
+            ( key.source * 0x9E3779B97F4A7C15ULL ) ^
+            ( key.page   * 0xC2B2AE3D27D4EB4FULL ) ^
+            ( key.tile   * 0x165667B19E3779F9ULL )
+        );
+        return shards_[ static_cast<unsigned int>( ( hash ^ ( hash >> 32 ) ) % number_of_shards_ ) ];
+    }
+
+private:
+    scoped_array<shard_t> const shards_             ;
+    unsigned int          const number_of_shards_   ;
+    std::size_t           const shard_memory_budget_;
+}; // class tile_cache
+
+//------------------------------------------------------------------------------
+} // namespace io
+//------------------------------------------------------------------------------
+} // namespace gil
+//------------------------------------------------------------------------------
+} // namespace boost
+//------------------------------------------------------------------------------
+#endif // tile_cache_hpp
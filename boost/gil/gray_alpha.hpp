@@ -0,0 +1,40 @@
+/*
+    Copyright 2026 GIL.IO2 contributors
+
+    Use, modification and distribution are subject to the Boost Software License,
+    Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+    http://www.boost.org/LICENSE_1_0.txt).
+
+    See http://opensource.adobe.com/gil for most recent version including documentation.
+*/
+/*************************************************************************************************/
+
+#ifndef GIL_GRAY_ALPHA_H
+#define GIL_GRAY_ALPHA_H
+
+////////////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Support for the gray + alpha color space (e.g. PNG colour type 4)
+///
+////////////////////////////////////////////////////////////////////////////////////////
+
+#include "gil_config.hpp"
+#include <boost/mpl/vector.hpp>
+#include "gray.hpp"
+#include "rgba.hpp"
+#include "pixel.hpp"
+
+namespace boost { namespace gil {
+
+/// \ingroup ColorSpaceModel
+typedef mpl::vector2<gray_color_t,alpha_t> gray_alpha_t;
+
+/// \ingroup LayoutModel
+typedef layout<gray_alpha_t> gray_alpha_layout_t;
+
+typedef pixel<bits8 ,gray_alpha_layout_t> gray_alpha8_pixel_t;
+typedef pixel<bits16,gray_alpha_layout_t> gray_alpha16_pixel_t;
+
+} }  // namespace boost::gil
+
+#endif
@@ -49,6 +49,15 @@ namespace boost { namespace gil {
 ///
 ////////////////////////////////////////////////////////////////////////////////////////
 
+/// \brief Tag selecting the image constructor/recreate overloads that allocate
+/// but do not construct (initialize) the pixels.
+/// \ingroup ImageModel
+///
+/// Intended for images whose pixels are about to be overwritten in full (e.g.
+/// by a decoder) and only valid for pixel types whose channels do not require
+/// construction (i.e. all the builtin GIL channel types).
+struct uninitialized_t {};
+
 template< typename Pixel, bool IsPlanar = false, typename Alloc=std::allocator<unsigned char> >    
 class image {
 public:
@@ -67,42 +76,88 @@ public:
 
     explicit image(std::size_t alignment=0,
                    const Alloc alloc_in = Alloc()) : 
-        _memory(0), _align_in_bytes(alignment), _alloc(alloc_in) {}
+        _memory(0), _align_in_bytes(alignment), _alloc(alloc_in), _external_deleter(0), _external_context(0) {}
 
     // Create with dimensions and optional initial value and alignment
     image(const point_t& dimensions,
           std::size_t alignment=0,
-          const Alloc alloc_in = Alloc()) : _memory(0), _align_in_bytes(alignment), _alloc(alloc_in) {
+          const Alloc alloc_in = Alloc()) : _memory(0), _align_in_bytes(alignment), _alloc(alloc_in), _external_deleter(0), _external_context(0) {
         allocate_and_default_construct(dimensions);
     }
     image(x_coord_t width, y_coord_t height,
           std::size_t alignment=0,
-          const Alloc alloc_in = Alloc()) : _memory(0), _align_in_bytes(alignment), _alloc(alloc_in) {
+          const Alloc alloc_in = Alloc()) : _memory(0), _align_in_bytes(alignment), _alloc(alloc_in), _external_deleter(0), _external_context(0) {
         allocate_and_default_construct(point_t(width,height));
     }
+    // Create with dimensions, leaving the pixels uninitialized
+    image(const point_t& dimensions,
+          uninitialized_t,
+          std::size_t alignment=0,
+          const Alloc alloc_in = Alloc()) : _memory(0), _align_in_bytes(alignment), _alloc(alloc_in), _external_deleter(0), _external_context(0) {
+        allocate_(dimensions,mpl::bool_<IsPlanar>());
+    }
     image(const point_t& dimensions, 
           const Pixel& p_in,
           std::size_t alignment,
           const Alloc alloc_in = Alloc())  :
-        _memory(0), _align_in_bytes(alignment), _alloc(alloc_in) {
+        _memory(0), _align_in_bytes(alignment), _alloc(alloc_in), _external_deleter(0), _external_context(0) {
         allocate_and_fill(dimensions, p_in);
     }
     image(x_coord_t width, y_coord_t height,
           const Pixel& p_in,
           std::size_t alignment,
           const Alloc alloc_in = Alloc())  :
-        _memory(0), _align_in_bytes(alignment), _alloc(alloc_in) {
+        _memory(0), _align_in_bytes(alignment), _alloc(alloc_in), _external_deleter(0), _external_context(0) {
         allocate_and_fill(point_t(width,height),p_in);
     }
 
+    /// \brief Function used to free an adopted (externally owned) buffer.
+    /// Receives the buffer start and the opaque context given together with it.
+    typedef void (*external_deleter_t)(void* p_buffer, void* p_context);
+
+    /// \brief Ownership of the pixel memory handed back by release().
+    /// The receiver is responsible for calling deleter(memory, context) once
+    /// it is done with the pixels (the deleter is never null).
+    struct released_buffer {
+        view_t             view;    // the pixels (may start after memory due to alignment)
+        unsigned char*     memory;  // start of the released block
+        std::size_t        size;    // size of the released block in bytes
+        external_deleter_t deleter;
+        void*              context;
+    };
+
+    // Adopt an externally owned buffer (e.g. an mmap-ed region, a pool chunk
+    // or shared memory) of the given dimensions and row stride without copying
+    // or initializing it. Planar images expect the planes to follow each
+    // other, each row_size_in_bytes*dimensions.y bytes long. The deleter is
+    // invoked with p_buffer and p_context when the image is destroyed or
+    // recreated; a null deleter denotes a non-owning (borrowed) buffer.
+    image(const point_t& dimensions,
+          unsigned char* p_buffer, std::ptrdiff_t row_size_in_bytes,
+          external_deleter_t deleter, void* p_context=0,
+          const Alloc alloc_in = Alloc()) :
+        _memory(p_buffer), _align_in_bytes(0), _alloc(alloc_in),
+        _external_deleter(deleter ? deleter : &non_owning_deleter), _external_context(p_context) {
+        BOOST_ASSERT(p_buffer || dimensions.x*dimensions.y==0);
+        set_view(dimensions, p_buffer, row_size_in_bytes*byte_to_memunit<typename view_t::x_iterator>::value, mpl::bool_<IsPlanar>());
+    }
+
+    // Adopt a buffer previously handed out by release() (of this or another
+    // image with the same view type and a possibly different allocator).
+    explicit image(const released_buffer& buffer, const Alloc alloc_in = Alloc()) :
+        _view(buffer.view), _memory(buffer.memory), _align_in_bytes(0), _alloc(alloc_in),
+        _external_deleter(buffer.deleter), _external_context(buffer.context) {
+        BOOST_ASSERT(_external_deleter);
+    }
+
     image(const image& img) :
-        _memory(0), _align_in_bytes(img._align_in_bytes), _alloc(img._alloc) {
+        _memory(0), _align_in_bytes(img._align_in_bytes), _alloc(img._alloc), _external_deleter(0), _external_context(0) {
         allocate_and_copy(img.dimensions(),img._view);
     }
 
     template <typename P2, bool IP2, typename Alloc2>
     image(const image<P2,IP2,Alloc2>& img) : 
-        _memory(0), _align_in_bytes(img._align_in_bytes), _alloc(img._alloc) {
+        _memory(0), _align_in_bytes(img._align_in_bytes), _alloc(img._alloc), _external_deleter(0), _external_context(0) {
        allocate_and_copy(img.dimensions(),img._view);
     }
     image& operator=(const image& img) {
@@ -127,10 +182,38 @@ public:
     }
 
     ~image() {
-        destruct_pixels(_view);
+        if (!_external_deleter)
+            destruct_pixels(_view);
         deallocate(_view.dimensions());
     }
 
+    /// \brief Relinquishes ownership of the pixel memory (without destroying
+    /// the pixels) and leaves the image empty. Allocator owned memory is
+    /// handed back together with a deleter that returns it to a copy of the
+    /// allocator.
+    released_buffer release() {
+        released_buffer result;
+        result.view   = _view;
+        result.memory = _memory;
+        if (_external_deleter) {
+            result.size    = 0; // unknown
+            result.deleter = _external_deleter;
+            result.context = _external_context;
+        } else {
+            result.size    = _memory ? total_allocated_size_in_bytes(_view.dimensions()) : 0;
+            result.deleter = &allocator_deleter;
+            result.context = _memory ? new allocator_deleter_context(_alloc, result.size) : 0;
+        }
+        _view             = view_t();
+        _memory           = 0;
+        _external_deleter = 0;
+        _external_context = 0;
+        return result;
+    }
+
+    /// \brief True if the pixel memory is externally owned (adopted).
+    bool is_external() const { return _external_deleter != 0; }
+
     Alloc&       allocator() { return _alloc; }
     Alloc const& allocator() const { return _alloc; }
 
@@ -140,6 +223,8 @@ public:
         swap(_memory,         img._memory);
         swap(_view,           img._view); 
         swap(_alloc,          img._alloc);
+        swap(_external_deleter, img._external_deleter);
+        swap(_external_context, img._external_context);
     }    
 
     void recreate(const point_t& dims, std::size_t alignment=0, const Alloc alloc_in = Alloc()) {
@@ -151,6 +236,14 @@ public:
     void recreate(x_coord_t width, y_coord_t height, std::size_t alignment=0, const Alloc alloc_in = Alloc()) {
         recreate(point_t(width,height),alignment,alloc_in);
     }
+    // Same as recreate() but the (new) pixels are left uninitialized. Existing
+    // memory is reused as-is when nothing changed.
+    void recreate_uninitialized(const point_t& dims, std::size_t alignment=0, const Alloc alloc_in = Alloc()) {
+        if (dims!=_view.dimensions() || _align_in_bytes!=alignment || alloc_in!=_alloc) {
+            image tmp(dims, uninitialized_t(), alignment, alloc_in);
+            swap(tmp);
+        }
+    }
     void recreate(const point_t& dims, 
                   const Pixel& p_in, std::size_t alignment, const Alloc alloc_in = Alloc()) {
         if (dims!=_view.dimensions() || _align_in_bytes!=alignment || alloc_in!=_alloc) {
@@ -168,6 +261,23 @@ private:
     unsigned char* _memory;
     std::size_t    _align_in_bytes;
     allocator_type _alloc;
+    external_deleter_t _external_deleter; // non-null for adopted buffers
+    void*              _external_context;
+
+    struct allocator_deleter_context {
+        allocator_deleter_context(const allocator_type& alloc_in, std::size_t size_in) : alloc(alloc_in), size(size_in) {}
+        allocator_type alloc;
+        std::size_t    size;
+    };
+
+    static void allocator_deleter(void* p_buffer, void* p_context) {
+        if (!p_buffer) return;
+        allocator_deleter_context* const p_allocator_context(static_cast<allocator_deleter_context*>(p_context));
+        p_allocator_context->alloc.deallocate(static_cast<unsigned char*>(p_buffer), p_allocator_context->size);
+        delete p_allocator_context;
+    }
+
+    static void non_owning_deleter(void*, void*) {}
 
     void allocate_and_default_construct(const point_t& dimensions) { 
         try {
@@ -205,7 +315,8 @@ private:
     }
 
     void deallocate(const point_t& dimensions) { 
-        if (_memory) _alloc.deallocate(_memory, total_allocated_size_in_bytes(dimensions));
+        if (_external_deleter) _external_deleter(_memory, _external_context);
+        else if (_memory) _alloc.deallocate(_memory, total_allocated_size_in_bytes(dimensions));
     }
 
     std::size_t total_allocated_size_in_bytes(const point_t& dimensions) const {
@@ -238,17 +349,19 @@ private:
         return size_in_memunits;
     }
     
-    void allocate_(const point_t& dimensions, mpl::false_) {  // if it throws and _memory!=0 the client must deallocate _memory
+    template <typename IsPlanarT>
+    void allocate_(const point_t& dimensions, IsPlanarT is_planar_tag) {  // if it throws and _memory!=0 the client must deallocate _memory
         _memory=_alloc.allocate(total_allocated_size_in_bytes(dimensions));
         unsigned char* tmp=(_align_in_bytes>0) ? (unsigned char*)align((std::size_t)_memory,_align_in_bytes) : _memory;
-        _view=view_t(dimensions,typename view_t::locator(typename view_t::x_iterator(tmp),get_row_size_in_memunits(dimensions.x)));
+        set_view(dimensions, tmp, get_row_size_in_memunits(dimensions.x), is_planar_tag);
     }
 
-    void allocate_(const point_t& dimensions, mpl::true_) {   // if it throws and _memory!=0 the client must deallocate _memory
-        std::size_t row_size=get_row_size_in_memunits(dimensions.x);
-        std::size_t plane_size=row_size*dimensions.y;
-        _memory=_alloc.allocate(total_allocated_size_in_bytes(dimensions));
-        unsigned char* tmp=(_align_in_bytes>0) ? (unsigned char*)align((std::size_t)_memory,_align_in_bytes) : _memory;
+    void set_view(const point_t& dimensions, unsigned char* tmp, std::ptrdiff_t row_size, mpl::false_) {
+        _view=view_t(dimensions,typename view_t::locator(typename view_t::x_iterator(tmp),row_size));
+    }
+
+    void set_view(const point_t& dimensions, unsigned char* tmp, std::ptrdiff_t row_size, mpl::true_) {
+        std::ptrdiff_t plane_size=row_size*dimensions.y;
         typename view_t::x_iterator first; 
         for (int i=0; i<num_channels<view_t>::value; ++i) {
             dynamic_at_c(first,i) = (typename channel_type<view_t>::type*)tmp;
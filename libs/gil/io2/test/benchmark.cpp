@@ -0,0 +1,593 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// benchmark.cpp
+/// -------------
+///
+/// GIL.IO2 decode/encode throughput benchmark.
+///
+/// Generates a deterministic synthetic corpus (through the native libraries
+/// directly, so that it does not depend on the features of the GIL.IO2
+/// writers) and measures decode (per backend and per copy_to() policy) and
+/// encode throughput. Results are printed to stdout as JSON lines, one
+/// measurement per line, e.g.:
+/// {"backend":"libtiff","case":"tiff_tiled_deflate","width":1024,"height":1024,"operation":"decode","policy":"preallocated_synchronize_formats","status":"ok","iterations":24,"seconds":0.512,"mpixels_per_second":49.1,"mbytes_per_second":140.6}
+/// The status is "ok", "unsupported" (a copy_to() policy that the library
+/// explicitly does not support for the given file, e.g. ensure_formats_match
+/// with a different native format) or "error" (with the exception message in
+/// "message"). Any error makes the benchmark exit with a non-zero status.
+///
+/// Usage: gio_io2_benchmark [corpus_directory] [megapixels_per_measurement]
+///
+/// Copyright (c) 2026. GIL.IO2 contributors.
+///
+////////////////////////////////////////////////////////////////////////////////
+//------------------------------------------------------------------------------
+#ifdef _MSC_VER
+#   pragma warning( push )
+#   pragma warning( disable : 4127 ) // "conditional expression is constant"
+#   pragma warning( disable : 4512 ) // "assignment operator could not be generated"
+#endif
+
+#define BOOST_MPL_LIMIT_VECTOR_SIZE 40
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include "windows.h"
+    #include "direct.h"
+#else
+    #include "sys/stat.h"
+    #include "sys/types.h"
+    #include "time.h"
+#endif // _WIN32
+
+#define BOOST_GIL_EXTERNAL_LIB ( BOOST_LIB_LINK_LOADTIME_OR_STATIC, BOOST_LIB_LOADING_STATIC, BOOST_LIB_INIT_ASSUME )
+#define BOOST_MMAP_HEADER_ONLY
+
+#include "boost/gil/extension/io2/backends/libjpeg/backend.hpp"
+#include "boost/gil/extension/io2/backends/libjpeg/reader.hpp"
+#include "boost/gil/extension/io2/backends/libjpeg/writer.hpp"
+#include "boost/gil/extension/io2/backends/libpng/backend.hpp"
+#include "boost/gil/extension/io2/backends/libpng/reader.hpp"
+#include "boost/gil/extension/io2/backends/libpng/writer.hpp"
+#include "boost/gil/extension/io2/backends/libtiff/backend.hpp"
+#include "boost/gil/extension/io2/backends/libtiff/reader.hpp"
+#include "boost/gil/extension/io2/backends/libtiff/writer.hpp"
+#include "boost/gil/extension/io2/devices/c_file_name.hpp"
+
+#include "boost/gil/image.hpp"
+#include "boost/gil/typedefs.hpp"
+
+#include <boost/type_traits/is_same.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <vector>
+//------------------------------------------------------------------------------
+namespace
+{
+//------------------------------------------------------------------------------
+
+using namespace boost;
+using namespace boost::gil;
+using namespace boost::gil::io;
+
+// A plain detail:: would be ambiguous (boost, gil and io all have one).
+using boost::gil::io::detail::cumulative_result;
+using boost::gil::io::detail::io_error;
+using boost::gil::io::detail::io_error_if_not;
+
+////////////////////////////////////////////////////////////////////////////////
+// Wall clock timing
+////////////////////////////////////////////////////////////////////////////////
+
+class stopwatch
+{
+public:
+    stopwatch() { restart(); }
+
+    void restart() { start_ = now(); }
+
+    double elapsed() const { return now() - start_; }
+
+private:
+    static double now()
+    {
+    #ifdef _WIN32
+        LARGE_INTEGER frequency; ::QueryPerformanceFrequency( &frequency );
+        LARGE_INTEGER counter  ; ::QueryPerformanceCounter  ( &counter   );
+        return double( counter.QuadPart ) / double( frequency.QuadPart );
+    #else
+        timespec time;
+        BOOST_VERIFY( ::clock_gettime( CLOCK_MONOTONIC, &time ) == 0 );
+        return time.tv_sec + time.tv_nsec / 1e9;
+    #endif // _WIN32
+    }
+
+    double start_;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Deterministic synthetic content
+////////////////////////////////////////////////////////////////////////////////
+
+// A mix of smooth gradients, hard edges and (LCG) noise so that the
+// compressors see something resembling photographic and synthetic content.
+unsigned int sample_value( unsigned int const x, unsigned int const y, unsigned int const channel, unsigned int const max_value )
+{
+    unsigned int noise( ( x * 1103515245u + y * 12345u + channel * 2654435761u ) );
+    noise ^= noise >> 16;
+    unsigned int const gradient( ( x * ( 3 + channel ) + y * ( 5 - channel ) ) & 0xFF );
+    unsigned int const edges   ( ( ( x / 37 + y / 53 ) & 1 ) * 0x40                );
+    unsigned int const value8  ( ( gradient + edges + ( noise & 0x0F ) ) & 0xFF    );
+    return ( max_value == 0xFF ) ? value8 : ( ( value8 << 8 ) | ( noise & 0xFF ) );
+}
+
+template <typename Sample>
+void fill_interleaved_row( std::vector<Sample> & row, unsigned int const width, unsigned int const y, unsigned int const channels, unsigned int const max_value )
+{
+    row.resize( width * channels );
+    for ( unsigned int x( 0 ); x < width; ++x )
+        for ( unsigned int c( 0 ); c < channels; ++c )
+            row[ x * channels + c ] = static_cast<Sample>( sample_value( x, y, c, max_value ) );
+}
+
+bool make_directory( std::string const & path )
+{
+#ifdef _WIN32
+    return ( ::_mkdir( path.c_str() ) == 0 ) || ( errno == EEXIST );
+#else
+    return ( ::mkdir( path.c_str(), 0755 ) == 0 ) || ( errno == EEXIST );
+#endif // _WIN32
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Corpus generation (native libraries)
+////////////////////////////////////////////////////////////////////////////////
+
+enum jpeg_kind { jpeg_baseline, jpeg_progressive, jpeg_restart };
+
+void generate_jpeg( std::string const & path, unsigned int const width, unsigned int const height, jpeg_kind const kind )
+{
+    std::FILE * const p_file( std::fopen( path.c_str(), "wb" ) );
+    io_error_if_not( p_file, "cannot create corpus file" );
+
+    jpeg_compress_struct compressor;
+    jpeg_error_mgr       error_manager;
+    compressor.err = ::jpeg_std_error( &error_manager );
+    ::jpeg_create_compress( &compressor );
+    ::jpeg_stdio_dest     ( &compressor, p_file );
+
+    compressor.image_width      = width ;
+    compressor.image_height     = height;
+    compressor.input_components = 3     ;
+    compressor.in_color_space   = JCS_RGB;
+    ::jpeg_set_defaults( &compressor );
+    ::jpeg_set_quality ( &compressor, 90, true );
+    if ( kind == jpeg_progressive )
+        ::jpeg_simple_progression( &compressor );
+    if ( kind == jpeg_restart )
+        compressor.restart_in_rows = 1;
+
+    ::jpeg_start_compress( &compressor, true );
+    std::vector<JSAMPLE> row;
+    for ( unsigned int y( 0 ); y < height; ++y )
+    {
+        fill_interleaved_row( row, width, y, 3, 0xFF );
+        JSAMPROW p_row( &row[ 0 ] );
+        ::jpeg_write_scanlines( &compressor, &p_row, 1 );
+    }
+    ::jpeg_finish_compress ( &compressor );
+    ::jpeg_destroy_compress( &compressor );
+    std::fclose( p_file );
+}
+
+
+enum png_kind { png_rgb8, png_rgb8_interlaced, png_rgb16, png_palette };
+
+void generate_png( std::string const & path, unsigned int const width, unsigned int const height, png_kind const kind )
+{
+    std::FILE * const p_file( std::fopen( path.c_str(), "wb" ) );
+    io_error_if_not( p_file, "cannot create corpus file" );
+
+    png_structp p_png ( ::png_create_write_struct( PNG_LIBPNG_VER_STRING, NULL, NULL, NULL ) );
+    png_infop   p_info( ::png_create_info_struct( p_png ) );
+    if ( setjmp( png_jmpbuf( p_png ) ) )
+    {
+        ::png_destroy_write_struct( &p_png, &p_info );
+        std::fclose( p_file );
+        io_error( "libpng corpus generation failed" );
+    }
+    ::png_init_io( p_png, p_file );
+
+    int const bit_depth ( ( kind == png_rgb16   ) ? 16                     : 8                  );
+    int const color_type( ( kind == png_palette ) ? PNG_COLOR_TYPE_PALETTE : PNG_COLOR_TYPE_RGB );
+    int const interlace ( ( kind == png_rgb8_interlaced ) ? PNG_INTERLACE_ADAM7 : PNG_INTERLACE_NONE );
+    ::png_set_IHDR( p_png, p_info, width, height, bit_depth, color_type, interlace, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT );
+
+    png_color palette[ 256 ];
+    if ( kind == png_palette )
+    {
+        for ( unsigned int i( 0 ); i < 256; ++i )
+        {
+            palette[ i ].red   = static_cast<png_byte>( sample_value( i, i, 0, 0xFF ) );
+            palette[ i ].green = static_cast<png_byte>( sample_value( i, i, 1, 0xFF ) );
+            palette[ i ].blue  = static_cast<png_byte>( sample_value( i, i, 2, 0xFF ) );
+        }
+        ::png_set_PLTE( p_png, p_info, palette, 256 );
+    }
+
+    ::png_write_info( p_png, p_info );
+
+    unsigned int const channels       ( ( kind == png_palette ) ? 1 : 3                                    );
+    int          const number_of_passes( ( interlace == PNG_INTERLACE_ADAM7 ) ? ::png_set_interlace_handling( p_png ) : 1 );
+    std::vector<png_byte> row8 ;
+    std::vector<png_byte> row16;
+    std::vector<unsigned short> samples16;
+    for ( int pass( 0 ); pass < number_of_passes; ++pass )
+    {
+        for ( unsigned int y( 0 ); y < height; ++y )
+        {
+            if ( bit_depth == 16 )
+            {
+                // PNG samples are big endian.
+                fill_interleaved_row( samples16, width, y, channels, 0xFFFF );
+                row16.resize( samples16.size() * 2 );
+                for ( std::size_t i( 0 ); i < samples16.size(); ++i )
+                {
+                    row16[ i * 2     ] = static_cast<png_byte>( samples16[ i ] >> 8 );
+                    row16[ i * 2 + 1 ] = static_cast<png_byte>( samples16[ i ]      );
+                }
+                ::png_write_row( p_png, &row16[ 0 ] );
+            }
+            else
+            {
+                fill_interleaved_row( row8, width, y, channels, 0xFF );
+                ::png_write_row( p_png, &row8[ 0 ] );
+            }
+        }
+    }
+
+    ::png_write_end( p_png, p_info );
+    ::png_destroy_write_struct( &p_png, &p_info );
+    std::fclose( p_file );
+}
+
+
+enum tiff_layout { tiff_stripped, tiff_tiled, tiff_planar };
+
+void generate_tiff( std::string const & path, unsigned int const width, unsigned int const height, tiff_layout const layout, uint16 const compression )
+{
+    TIFF * const p_tiff( ::TIFFOpen( path.c_str(), "w" ) );
+    io_error_if_not( p_tiff, "cannot create corpus file" );
+
+    uint16 const planar_configuration( ( layout == tiff_planar ) ? PLANARCONFIG_SEPARATE : PLANARCONFIG_CONTIG );
+    ::TIFFSetField( p_tiff, TIFFTAG_IMAGEWIDTH     , width                );
+    ::TIFFSetField( p_tiff, TIFFTAG_IMAGELENGTH    , height               );
+    ::TIFFSetField( p_tiff, TIFFTAG_BITSPERSAMPLE  , 8                    );
+    ::TIFFSetField( p_tiff, TIFFTAG_SAMPLESPERPIXEL, 3                    );
+    ::TIFFSetField( p_tiff, TIFFTAG_PHOTOMETRIC    , PHOTOMETRIC_RGB      );
+    ::TIFFSetField( p_tiff, TIFFTAG_PLANARCONFIG   , planar_configuration );
+    ::TIFFSetField( p_tiff, TIFFTAG_COMPRESSION    , compression          );
+    if ( compression != COMPRESSION_NONE )
+        ::TIFFSetField( p_tiff, TIFFTAG_PREDICTOR, PREDICTOR_HORIZONTAL );
+
+    cumulative_result result;
+    std::vector<unsigned char> row;
+    if ( layout == tiff_tiled )
+    {
+        uint32 const tile_size( 256 );
+        ::TIFFSetField( p_tiff, TIFFTAG_TILEWIDTH , tile_size );
+        ::TIFFSetField( p_tiff, TIFFTAG_TILELENGTH, tile_size );
+        std::vector<unsigned char> tile( ::TIFFTileSize( p_tiff ) );
+        for ( uint32 tile_y( 0 ); tile_y < height; tile_y += tile_size )
+        {
+            for ( uint32 tile_x( 0 ); tile_x < width; tile_x += tile_size )
+            {
+                std::fill( tile.begin(), tile.end(), 0 );
+                for ( uint32 y( tile_y ); y < std::min( tile_y + tile_size, height ); ++y )
+                    for ( uint32 x( tile_x ); x < std::min( tile_x + tile_size, width ); ++x )
+                        for ( unsigned int c( 0 ); c < 3; ++c )
+                            tile[ ( ( y - tile_y ) * tile_size + ( x - tile_x ) ) * 3 + c ] = static_cast<unsigned char>( sample_value( x, y, c, 0xFF ) );
+                result.accumulate_greater( ::TIFFWriteEncodedTile( p_tiff, ::TIFFComputeTile( p_tiff, tile_x, tile_y, 0, 0 ), &tile[ 0 ], tile.size() ), 0 );
+            }
+        }
+    }
+    else
+    {
+        ::TIFFSetField( p_tiff, TIFFTAG_ROWSPERSTRIP, ::TIFFDefaultStripSize( p_tiff, 0 ) );
+        unsigned int const planes( ( layout == tiff_planar ) ? 3 : 1 );
+        for ( unsigned int plane( 0 ); plane < planes; ++plane )
+        {
+            for ( uint32 y( 0 ); y < height; ++y )
+            {
+                if ( planes == 1 )
+                    fill_interleaved_row( row, width, y, 3, 0xFF );
+                else
+                {
+                    row.resize( width );
+                    for ( uint32 x( 0 ); x < width; ++x )
+                        row[ x ] = static_cast<unsigned char>( sample_value( x, y, plane, 0xFF ) );
+                }
+                result.accumulate_equal( ::TIFFWriteScanline( p_tiff, &row[ 0 ], y, static_cast<tsample_t>( plane ) ), 1 );
+            }
+        }
+    }
+    ::TIFFClose( p_tiff );
+    result.throw_if_error( "libtiff corpus generation failed" );
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Measurement and reporting
+////////////////////////////////////////////////////////////////////////////////
+
+struct measurement_t
+{
+    char const * backend  ;
+    char const * case_name;
+    unsigned int width    ;
+    unsigned int height   ;
+    char const * operation;
+    char const * policy   ;
+};
+
+void report( measurement_t const & m, char const * const status, unsigned int const iterations, double const seconds, std::size_t const bytes_per_iteration )
+{
+    double const pixels( double( m.width ) * m.height * iterations );
+    double const bytes ( double( bytes_per_iteration ) * iterations );
+    std::printf
+    (
+        "{\"backend\":\"%s\",\"case\":\"%s\",\"width\":%u,\"height\":%u,\"operation\":\"%s\",\"policy\":\"%s\",\"status\":\"%s\",\"iterations\":%u,\"seconds\":%.6f,\"mpixels_per_second\":%.3f,\"mbytes_per_second\":%.3f}\n",
+        m.backend, m.case_name, m.width, m.height, m.operation, m.policy, status, iterations, seconds,
+        seconds > 0 ? pixels / seconds / 1e6 : 0.0,
+        seconds > 0 ? bytes  / seconds / 1e6 : 0.0
+    );
+    std::fflush( stdout );
+}
+
+unsigned int number_of_errors( 0 );
+
+void report_error( measurement_t const & m, char const * const what )
+{
+    // Keep the line valid JSON (the messages are plain text anyway).
+    std::string message( what );
+    std::replace( message.begin(), message.end(), '"' , '\'' );
+    std::replace( message.begin(), message.end(), '\\', '/'  );
+    std::printf
+    (
+        "{\"backend\":\"%s\",\"case\":\"%s\",\"width\":%u,\"height\":%u,\"operation\":\"%s\",\"policy\":\"%s\",\"status\":\"error\",\"message\":\"%s\"}\n",
+        m.backend, m.case_name, m.width, m.height, m.operation, m.policy, message.c_str()
+    );
+    std::fflush( stdout );
+    ++number_of_errors;
+}
+
+template <class Operation>
+void measure( measurement_t const & m, unsigned int const iterations, std::size_t const bytes_per_iteration, Operation operation )
+{
+    try
+    {
+        // Only combinations that the library explicitly does not support (as
+        // opposed to failures) are reported as such.
+        if ( !operation.supported() )
+        {
+            report( m, "unsupported", 0, 0, 0 );
+            return;
+        }
+        operation(); // warm-up (and validation) run
+        stopwatch timer;
+        for ( unsigned int i( 0 ); i < iterations; ++i )
+            operation();
+        report( m, "ok", iterations, timer.elapsed(), bytes_per_iteration );
+    }
+    catch ( std::exception const & error )
+    {
+        report_error( m, error.what() );
+    }
+}
+
+
+template <class Backend, class Image>
+struct decode_image_synchronize_all
+{
+    std::string const * p_path;
+    void operator()() const
+    {
+        typedef typename Backend::template reader_for<char const *>::type reader_t;
+        Image image;
+        reader_t( p_path->c_str() ).copy_to_image( image, synchronize_dimensions(), synchronize_formats() );
+    }
+    bool supported() const { return true; }
+};
+
+template <class Backend, class Image, class FormatsPolicy>
+struct decode_preallocated
+{
+    std::string const * p_path;
+    Image             * p_image;
+    void operator()() const
+    {
+        typedef typename Backend::template reader_for<char const *>::type reader_t;
+        reader_t( p_path->c_str() ).copy_to( view( *p_image ), ensure_dimensions_match(), FormatsPolicy() );
+    }
+    // ensure_formats_match on a file with a different native format.
+    bool supported() const
+    {
+        if ( !is_same<FormatsPolicy, ensure_formats_match>::value )
+            return true;
+        typedef typename Backend::template reader_for<char const *>::type reader_t;
+        return
+            reader_t( p_path->c_str() ).closest_gil_supported_format() ==
+            Backend::template get_native_format<typename Image::view_t>::value;
+    }
+};
+
+template <class Backend, class View>
+struct encode_view
+{
+    std::string const * p_path;
+    View                view  ;
+    void operator()() const
+    {
+        typedef typename Backend::template writer_for<char const *>::type writer_t;
+        writer_t( p_path->c_str(), view ).write_default();
+    }
+    bool supported() const { return true; }
+};
+
+
+unsigned int iterations_for( unsigned int const width, unsigned int const height, double const megapixels_per_measurement )
+{
+    return std::max( 1u, static_cast<unsigned int>( megapixels_per_measurement * 1e6 / ( double( width ) * height ) ) );
+}
+
+std::size_t file_size( std::string const & path )
+{
+    std::FILE * const p_file( std::fopen( path.c_str(), "rb" ) );
+    if ( !p_file )
+        return 0;
+    std::fseek( p_file, 0, SEEK_END );
+    long const size( std::ftell( p_file ) );
+    std::fclose( p_file );
+    return static_cast<std::size_t>( size );
+}
+
+
+/// Decodes the given file with every copy_to() policy. Image is the GIL image
+/// type closest to the native format of the file, Rgb8Image the common
+/// 'converting' target.
+template <class Backend, class Image>
+void benchmark_decode( char const * const backend, char const * const case_name, std::string const & path, unsigned int const width, unsigned int const height, double const megapixels_per_measurement )
+{
+    unsigned int const iterations( iterations_for( width, height, megapixels_per_measurement ) );
+    std::size_t  const encoded    ( file_size( path )                                          );
+
+    measurement_t m = { backend, case_name, width, height, "decode", "" };
+
+    {
+        m.policy = "synchronize_dimensions_synchronize_formats";
+        decode_image_synchronize_all<Backend, Image> const operation = { &path };
+        measure( m, iterations, encoded, operation );
+    }
+    {
+        Image image( width, height );
+        m.policy = "preallocated_ensure_formats_match";
+        decode_preallocated<Backend, Image, ensure_formats_match> const operation = { &path, &image };
+        measure( m, iterations, encoded, operation );
+    }
+    {
+        Image image( width, height );
+        m.policy = "preallocated_synchronize_formats";
+        decode_preallocated<Backend, Image, synchronize_formats> const operation = { &path, &image };
+        measure( m, iterations, encoded, operation );
+    }
+    {
+        rgb8_image_t image( width, height );
+        m.policy = "preallocated_convert_to_rgb8";
+        decode_preallocated<Backend, rgb8_image_t, synchronize_formats> const operation = { &path, &image };
+        measure( m, iterations, encoded, operation );
+    }
+}
+
+template <class Backend, class Image>
+void benchmark_encode( char const * const backend, char const * const case_name, std::string const & path, unsigned int const width, unsigned int const height, double const megapixels_per_measurement )
+{
+    Image image( width, height );
+    typename Image::view_t const target( view( image ) );
+    for ( unsigned int y( 0 ); y < height; ++y )
+        for ( unsigned int x( 0 ); x < width; ++x )
+            for ( int c( 0 ); c < num_channels<Image>::value; ++c )
+                dynamic_at_c( target( x, y ), c ) = static_cast<typename channel_type<Image>::type>( sample_value( x, y, c, channel_traits<typename channel_type<Image>::type>::max_value() ) );
+
+    measurement_t const m = { backend, case_name, width, height, "encode", "write_default" };
+    encode_view<Backend, typename Image::view_t> const operation = { &path, target };
+    measure( m, iterations_for( width, height, megapixels_per_measurement ), width * height * sizeof( typename Image::value_type ), operation );
+}
+
+//------------------------------------------------------------------------------
+} // anonymous namespace
+//------------------------------------------------------------------------------
+
+int main( int argc, char * argv[] )
+{
+    std::string const corpus_directory          ( ( argc > 1 ) ? argv[ 1 ]                  : BOOST_TEST_GIL_IO_IMAGES_PATH "/_benchmark_corpus" );
+    double      const megapixels_per_measurement( ( argc > 2 ) ? std::atof( argv[ 2 ] ) : 64.0                                               );
+
+    if ( !make_directory( corpus_directory ) )
+    {
+        std::fprintf( stderr, "Cannot create the corpus directory %s.\n", corpus_directory.c_str() );
+        return EXIT_FAILURE;
+    }
+
+    typedef image<rgb8_pixel_t , false> rgb8_t       ;
+    typedef image<rgb16_pixel_t, false> rgb16_t      ;
+    typedef image<rgb8_pixel_t , true > rgb8_planar_t;
+
+    unsigned int const sizes[] = { 256, 1024, 4096 };
+
+    try
+    {
+        for ( unsigned int size_index( 0 ); size_index < sizeof( sizes ) / sizeof( sizes[ 0 ] ); ++size_index )
+        {
+            unsigned int const w( sizes[ size_index ] );
+            unsigned int const h( sizes[ size_index ] );
+            char size_suffix[ 32 ];
+            std::sprintf( size_suffix, "_%ux%u", w, h );
+            std::string const base( corpus_directory + "/" );
+
+            #define BENCHMARK_CASE( backend, image_t, name, extension, generator ) \
+            {                                                                    \
+                std::string const path( base + #name + size_suffix + extension );\
+                generator;                                                       \
+                benchmark_decode<backend##_image, image_t>( #backend, #name, path, w, h, megapixels_per_measurement ); \
+            }
+
+            BENCHMARK_CASE( libjpeg, rgb8_t       , jpeg_baseline      , ".jpg", generate_jpeg( path, w, h, jpeg_baseline       ) )
+            BENCHMARK_CASE( libjpeg, rgb8_t       , jpeg_progressive   , ".jpg", generate_jpeg( path, w, h, jpeg_progressive    ) )
+            BENCHMARK_CASE( libjpeg, rgb8_t       , jpeg_restart       , ".jpg", generate_jpeg( path, w, h, jpeg_restart        ) )
+            BENCHMARK_CASE( libpng , rgb8_t       , png_rgb8           , ".png", generate_png ( path, w, h, png_rgb8            ) )
+            BENCHMARK_CASE( libpng , rgb8_t       , png_rgb8_interlaced, ".png", generate_png ( path, w, h, png_rgb8_interlaced ) )
+            BENCHMARK_CASE( libpng , rgb16_t      , png_rgb16          , ".png", generate_png ( path, w, h, png_rgb16           ) )
+            BENCHMARK_CASE( libpng , rgb8_t       , png_palette        , ".png", generate_png ( path, w, h, png_palette         ) )
+            BENCHMARK_CASE( libtiff, rgb8_t       , tiff_stripped      , ".tif", generate_tiff( path, w, h, tiff_stripped, COMPRESSION_NONE    ) )
+            BENCHMARK_CASE( libtiff, rgb8_t       , tiff_stripped_lzw  , ".tif", generate_tiff( path, w, h, tiff_stripped, COMPRESSION_LZW     ) )
+            BENCHMARK_CASE( libtiff, rgb8_t       , tiff_stripped_zip  , ".tif", generate_tiff( path, w, h, tiff_stripped, COMPRESSION_ADOBE_DEFLATE ) )
+            BENCHMARK_CASE( libtiff, rgb8_t       , tiff_tiled         , ".tif", generate_tiff( path, w, h, tiff_tiled   , COMPRESSION_NONE    ) )
+            BENCHMARK_CASE( libtiff, rgb8_t       , tiff_tiled_zip     , ".tif", generate_tiff( path, w, h, tiff_tiled   , COMPRESSION_ADOBE_DEFLATE ) )
+            BENCHMARK_CASE( libtiff, rgb8_planar_t, tiff_planar_lzw    , ".tif", generate_tiff( path, w, h, tiff_planar  , COMPRESSION_LZW     ) )
+
+            #undef BENCHMARK_CASE
+
+            benchmark_encode<libjpeg_image, rgb8_t       >( "libjpeg", "jpeg_rgb8"       , base + "encoded" + size_suffix + ".jpg"        , w, h, megapixels_per_measurement );
+            benchmark_encode<libpng_image , rgb8_t       >( "libpng" , "png_rgb8"        , base + "encoded" + size_suffix + ".png"        , w, h, megapixels_per_measurement );
+            benchmark_encode<libpng_image , rgb16_t      >( "libpng" , "png_rgb16"       , base + "encoded" + size_suffix + "_16.png"     , w, h, megapixels_per_measurement );
+            benchmark_encode<libtiff_image, rgb8_t       >( "libtiff", "tiff_rgb8"       , base + "encoded" + size_suffix + ".tif"        , w, h, megapixels_per_measurement );
+            benchmark_encode<libtiff_image, rgb8_planar_t>( "libtiff", "tiff_rgb8_planar", base + "encoded" + size_suffix + "_planar.tif" , w, h, megapixels_per_measurement );
+        }
+    }
+    catch ( std::exception const & error )
+    {
+        std::fprintf( stderr, "Benchmark failed: %s\n", error.what() );
+        return EXIT_FAILURE;
+    }
+
+    if ( number_of_errors )
+    {
+        std::fprintf( stderr, "%u measurement(s) failed.\n", number_of_errors );
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+#ifdef _MSC_VER
+#   pragma warning( pop )
+#endif
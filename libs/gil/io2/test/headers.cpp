@@ -0,0 +1,35 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// headers.cpp
+/// -----------
+///
+/// Copyright (c) GIL.IO2 contributors 2026.
+///
+/// Compile-only check of the portable GIL.IO2 headers (everything except the
+/// Windows-only GDI+ and WIC backends).
+///
+////////////////////////////////////////////////////////////////////////////////
+//------------------------------------------------------------------------------
+// The backends expect the devices to be visible before they are included.
+#include "boost/gil/extension/io2/devices/c_file_name.hpp"
+#include "boost/gil/extension/io2/devices/c_file.hpp"
+#include "boost/gil/extension/io2/devices/c_file_descriptor.hpp"
+
+#include "boost/gil/extension/io2/backends/libjpeg/backend.hpp"
+#include "boost/gil/extension/io2/backends/libjpeg/reader.hpp"
+#include "boost/gil/extension/io2/backends/libjpeg/writer.hpp"
+#include "boost/gil/extension/io2/backends/libpng/backend.hpp"
+#include "boost/gil/extension/io2/backends/libpng/reader.hpp"
+#include "boost/gil/extension/io2/backends/libpng/writer.hpp"
+#include "boost/gil/extension/io2/backends/libtiff/backend.hpp"
+#include "boost/gil/extension/io2/backends/libtiff/reader.hpp"
+#include "boost/gil/extension/io2/backends/libtiff/writer.hpp"
+
+#include "boost/gil/extension/io2/band_reader.hpp"
+#include "boost/gil/extension/io2/detail/parallel.hpp"
+#include "boost/gil/extension/io2/detail/scratch_arena.hpp"
+#include "boost/gil/extension/io2/huge_page_allocator.hpp"
+#include "boost/gil/extension/io2/tile_cache.hpp"
+
+#include "boost/gil/gray_alpha.hpp"
+//------------------------------------------------------------------------------